@@ -14,6 +14,7 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 #include <SDL_image.h>
 
 #include "background.h"
+#include "gfx.h"
 #include "smocc.h"
 
 namespace smocc::background
@@ -32,7 +33,6 @@ void init()
 
 void update()
 {
-    SDL_Renderer* renderer = smocc::getRenderer();
     SDL_Rect windowRect;
 
     windowRect.x = 0;
@@ -40,9 +40,7 @@ void update()
 
     SDL_GetWindowSize(smocc::getWindow(), &windowRect.w, &windowRect.h);
 
-    int res = SDL_RenderCopy(renderer, _background, NULL, &windowRect);
-
-    assert(res == 0);
+    gfx::renderTexture(_background, &windowRect);
 }
 
 } // namespace smocc::background
\ No newline at end of file
@@ -0,0 +1,343 @@
+/*
+
+bench.cc: Scenario benchmarks for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "bots.h"
+#include "buffs.h"
+#include "bullets.h"
+#include "enemies.h"
+#include "explosions.h"
+#include "game.h"
+#include "input.h"
+#include "player.h"
+#include "rng.h"
+#include "smocc.h"
+#include "workers.h"
+
+using namespace std;
+
+namespace smocc::bench
+{
+
+// Heap allocations made so far, counted only by the benchmark build, through
+// all the replaceable forms of `new`. Workers can allocate too.
+atomic<unsigned long long> _allocations = 0;
+
+} // namespace smocc::bench
+
+#ifdef SMOCC_BENCH
+
+void* operator new(size_t size)
+{
+    smocc::bench::_allocations++;
+
+    void* p = malloc(size > 0 ? size : 1);
+
+    if (p == nullptr) throw bad_alloc();
+
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+    smocc::bench::_allocations++;
+
+    return malloc(size > 0 ? size : 1);
+}
+
+void operator delete(void* p, const nothrow_t&) noexcept
+{
+    free(p);
+}
+
+// Allocations of types aligned past what malloc guarantees, like SSE vectors.
+void* operator new(size_t size, align_val_t alignment)
+{
+    void* p = operator new(size, alignment, nothrow);
+
+    if (p == nullptr) throw bad_alloc();
+
+    return p;
+}
+
+void* operator new(
+    size_t size, align_val_t alignment, const nothrow_t&
+) noexcept
+{
+    smocc::bench::_allocations++;
+
+    // The size given to aligned_alloc must be a multiple of the alignment.
+    size_t a = static_cast<size_t>(alignment);
+    size_t alignedSize = (max(size, (size_t)1) + a - 1) / a * a;
+
+    return aligned_alloc(a, alignedSize);
+}
+
+void operator delete(void* p, align_val_t) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t, align_val_t) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, align_val_t, const nothrow_t&) noexcept
+{
+    free(p);
+}
+
+#endif
+
+namespace smocc::bench
+{
+
+using enum buffs::BuffType;
+
+struct Scenario
+{
+    const char* name;
+
+    // Counts the enemies and bullets are topped up to before every tick. With
+    // zero, the game alone decides how many there are.
+    unsigned int enemies;
+    unsigned int bullets;
+
+    bool allBuffs;
+    bool friendlyBots;
+};
+
+// Time and allocations of a game module, over the measured ticks.
+struct Measurement
+{
+    unsigned long long nanoseconds;
+    unsigned long long allocations;
+};
+
+const unsigned long long _SEED = 342;
+
+const Scenario _SCENARIOS[] = {
+    {"idle", 0, 0, false, false},
+    {"enemies_100_bullets_500", 100, 500, false, false},
+    {"enemies_400_bullets_2000", 400, 2000, false, false},
+    {"all_buffs", 100, 0, true, false},
+    {"friendly_bots", 100, 0, false, true},
+};
+
+// Measurements of the game modules, in the same order.
+vector<Measurement> _measurements;
+
+unsigned int _warmupTicks = DEFAULT_WARMUP_TICKS;
+unsigned int _ticks = DEFAULT_TICKS;
+const char* _onlyScenario = nullptr;
+
+// Drives the scripted spawns, independently of the game random streams.
+minstd_rand _random;
+
+void _init(int, char*[]);
+void _parseArguments(int, char*[]);
+void _runScenario(const Scenario& scenario);
+void _prepareTick(const Scenario& scenario);
+void _tick(bool measure);
+void _printResults(const Scenario& scenario);
+double _roll();
+
+int main(int argc, char* argv[])
+{
+    _init(argc, argv);
+
+    cout << "scenario,module,ns_per_tick,allocations_per_tick" << endl;
+
+    for (const Scenario& scenario : _SCENARIOS)
+    {
+        if (_onlyScenario && strcmp(_onlyScenario, scenario.name)) continue;
+
+        _runScenario(scenario);
+        _printResults(scenario);
+    }
+
+    return 0;
+}
+
+void _init(int argc, char* argv[])
+{
+    smocc::workers::init();
+    smocc::rng::init();
+    smocc::game::init();
+    smocc::input::init();
+    smocc::player::init();
+    smocc::enemies::init();
+    smocc::bots::init();
+    smocc::bullets::init();
+    smocc::explosions::init();
+    smocc::buffs::init();
+
+    _parseArguments(argc, argv);
+}
+
+void _parseArguments(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (!strcmp(argv[i], "--scenario") && hasValue)
+        {
+            _onlyScenario = argv[++i];
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--ticks") && hasValue)
+        {
+            _ticks = max(atoi(argv[++i]), 1);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--warmup-ticks") && hasValue)
+        {
+            _warmupTicks = atoi(argv[++i]);
+            continue;
+        }
+
+        cerr << "Ignoring unknown argument: " << argv[i] << endl;
+    }
+}
+
+void _runScenario(const Scenario& scenario)
+{
+    _measurements.assign(smocc::GAME_MODULES_COUNT, {0, 0});
+
+    // Keeps the game messages out of the results.
+    cout.setstate(ios::failbit);
+
+    smocc::rng::seed(_SEED);
+    _random.seed(_SEED);
+
+    smocc::player::setInvulnerable(true);
+    smocc::game::begin();
+
+    for (unsigned int i = 0; i < _warmupTicks + _ticks; i++)
+    {
+        _prepareTick(scenario);
+        _tick(i >= _warmupTicks);
+    }
+
+    smocc::game::end();
+
+    // Game modules reset themselves when updated while no game is running.
+    smocc::updateGame();
+
+    cout.clear();
+}
+
+void _prepareTick(const Scenario& scenario)
+{
+    int w, h;
+
+    smocc::getWorldSize(&w, &h);
+
+    while (smocc::enemies::all().size() < scenario.enemies)
+        smocc::enemies::spawn();
+
+    while (smocc::bullets::count() < scenario.bullets)
+    {
+        double angle = 2 * M_PI * _roll();
+
+        smocc::bullets::spawn(_roll() * w, _roll() * h, cos(angle), sin(angle));
+    }
+
+    // Buffs are kept as the scenario wants them, also when the player picks up
+    // buff drops.
+    for (buffs::BuffType type : buffs::BUFF_TYPES)
+    {
+        bool wanted = scenario.allBuffs;
+        bool active = smocc::buffs::isActive(type);
+
+        wanted = wanted || (scenario.friendlyBots && type == FRIENDLY_BOTS);
+
+        if (wanted && !active) smocc::buffs::activate(type);
+        if (!wanted && active) smocc::buffs::deactivate(type);
+    }
+}
+
+void _tick(bool measure)
+{
+    smocc::game::scheduleTicks(1);
+
+    if (!smocc::game::tick()) return;
+
+    for (unsigned int i = 0; i < smocc::GAME_MODULES_COUNT; i++)
+    {
+        unsigned long long allocations = _allocations;
+        auto start = chrono::steady_clock::now();
+
+        smocc::GAME_MODULES[i].update();
+
+        auto end = chrono::steady_clock::now();
+
+        if (!measure) continue;
+
+        auto elapsed = chrono::duration_cast<chrono::nanoseconds>(end - start);
+
+        _measurements[i].nanoseconds += elapsed.count();
+        _measurements[i].allocations += _allocations - allocations;
+    }
+}
+
+void _printResults(const Scenario& scenario)
+{
+    unsigned long long totalNanoseconds = 0;
+    unsigned long long totalAllocations = 0;
+
+    for (unsigned int i = 0; i < smocc::GAME_MODULES_COUNT; i++)
+    {
+        const Measurement& measurement = _measurements[i];
+
+        totalNanoseconds += measurement.nanoseconds;
+        totalAllocations += measurement.allocations;
+
+        cout << scenario.name << "," << smocc::GAME_MODULES[i].name << ",";
+        cout << measurement.nanoseconds / _ticks << ",";
+        cout << (double)measurement.allocations / _ticks << endl;
+    }
+
+    cout << scenario.name << ",total,";
+    cout << totalNanoseconds / _ticks << ",";
+    cout << (double)totalAllocations / _ticks << endl;
+}
+
+double _roll()
+{
+    return uniform_real_distribution<double>(0.0, 1.0)(_random);
+}
+
+} // namespace smocc::bench
@@ -0,0 +1,24 @@
+/*
+
+bench.h: Scenario benchmarks for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#pragma once
+
+namespace smocc::bench
+{
+
+const unsigned int DEFAULT_WARMUP_TICKS = 100;
+const unsigned int DEFAULT_TICKS = 1000;
+
+// Entry point of the benchmark build. Runs each scenario headless for a fixed
+// number of ticks, and prints as CSV the time spent and the heap allocations
+// made by each module per tick.
+int main(int, char**);
+
+} // namespace smocc::bench
@@ -8,12 +8,18 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 
 */
 
-// FIXME: buggy and laggy!
+// FIXME: buggy!
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <limits>
 #include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "bots.h"
 #include "buffs.h"
@@ -25,6 +31,7 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 #include "player.h"
 #include "rng.h"
 #include "smocc.h"
+#include "workers.h"
 
 using namespace std;
 
@@ -44,6 +51,21 @@ const double _BOT_HEAT_FACTOR = 0.3;
 const double _WORLD_EDGES_HEAT_FACTOR = 0.5;
 const double _ENEMY_HEAT_FACTOR = 1.0;
 
+// Distance from the edge of enemies within which they heat up waypoints. The
+// heat of an enemy is made to fall to zero there, so that each enemy only
+// affects the waypoints around it.
+const double _ENEMY_HEAT_REACH_PIXELS = 150;
+
+// Levels of the heat pyramid, each of a quarter of the blocks of the previous,
+// from single cells up to a single block for the whole map.
+const int _HEAT_PYRAMID_LEVELS = 8;
+
+static_assert(_WAYPOINT_GRID_COLUMNS <= 1 << (_HEAT_PYRAMID_LEVELS - 1));
+static_assert(_WAYPOINT_GRID_ROWS <= 1 << (_HEAT_PYRAMID_LEVELS - 1));
+
+// Number of angular sectors enemies are sorted into when casting shadows.
+const int _SHADOW_BINS = 1024;
+
 const double _AIM_FULL_ROTATION_SPEED_MILLISECONDS = 1000;
 
 const double _AIM_ROTATION_RADIANS_PER_MILLISECOND =
@@ -67,6 +89,78 @@ struct PointOfInterest
     double targetY;
 };
 
+// Heat an enemy added to the waypoints within its cells, as of the last heat
+// map update.
+struct EnemyHeat
+{
+    unsigned long long id;
+    double x;
+    double y;
+    double radius;
+    int health;
+    double speed;
+
+    // The heat is (scale / distance) ^ power - offset, within the reach, where
+    // the offset is the heat at the reach, if it's not too large to take off.
+    double scale;
+    double power;
+    double reach;
+    double offset;
+
+    // Waypoint cells within the reach, inclusive. Empty when off the grid.
+    int firstColumn;
+    int lastColumn;
+    int firstRow;
+    int lastRow;
+};
+
+// Enemies in the way of segments from a point, sorted by the direction of the
+// segments into angular bins. A segment from the point can only intersect the
+// enemies of its bin, and only if it's at least as long as the bin clearance.
+struct Shadows
+{
+    double x;
+    double y;
+
+    // Indices into the enemies of each bin are from `binStarts[bin]` up to
+    // `binStarts[bin + 1]`, excluded.
+    unsigned int binStarts[_SHADOW_BINS + 1];
+    double clearances[_SHADOW_BINS];
+    vector<unsigned int> enemies;
+};
+
+// Heat that falls off with the distance from a point, as k * max distance /
+// distance, like that of the player and the bots.
+struct PointHeat
+{
+    double x;
+    double y;
+    double k;
+};
+
+// Block of cells of a level of the heat pyramid, with a lower bound for the
+// heat of its cells.
+struct HeatBlock
+{
+    int level;
+    int row;
+    int column;
+    double minHeat;
+};
+
+// World as of the start of the bots planning, which bots plan from, so that
+// bots planning in parallel see the same one whatever order they're done in.
+// Enemies don't change while bots update, so they're only viewed.
+struct Snapshot
+{
+    span<const enemies::Enemy> enemies;
+    double playerX;
+    double playerY;
+    double botX[BOTS_COUNT];
+    double botY[BOTS_COUNT];
+    bool botActive[BOTS_COUNT];
+};
+
 struct Bot
 {
     unsigned int index;
@@ -74,22 +168,37 @@ struct Bot
 
     double x;
     double y;
+    double previousX;
+    double previousY;
     bool active;
     bool reset;
     PointOfInterest poi;
     Aim aim;
+    Shadows shadows;
 };
 
 void _reset();
 
 void _updateWaypoints();
 void _updateHeatMap();
-void _updateHeatPoint(unsigned int col, unsigned int row);
-double _getPlayerHeat(double x, double y);
+void _resetHeatMap();
+void _markHeatCells(const EnemyHeat& heat);
+void _updateHeatRow(int row);
+void _addEnemyHeatRow(const EnemyHeat& heat, int row, int first, int last);
+void _addPointHeatRow(double* cells, int row, int first, int last, PointHeat p);
+void _updatePyramid(int* firstColumns, int* lastColumns);
+int _pyramidColumns(int level);
+int _pyramidRows(int level);
+double _blockMinHeat(
+    int level, int row, int column, const PointHeat* sources, int sourceCount
+);
+EnemyHeat _makeEnemyHeat(const enemies::Enemy& enemy);
+bool _enemyHeatChanged(const EnemyHeat& a, const EnemyHeat& b);
 double _getWorldEdgesHeat(double x, double y);
-double _getBotHeat(double x, double y, unsigned int botIndex);
-double _getEnemyHeat(double x, double y, const enemies::Enemy& enemy);
+double _getEnemyHeat(double x, double y, const EnemyHeat& heat);
 void _activateBot(Bot& bot);
+void _takeSnapshot();
+void _planBot(int index);
 void _updateBot(Bot& bot);
 void _resetBot(Bot& bot);
 void _updateBotPosition(Bot& bot);
@@ -101,20 +210,55 @@ void getDirectionToAim(
     Bot& bot, const enemies::Enemy& target, double* aimX, double* aimY
 );
 double getTargetPriority(Bot& bot, const enemies::Enemy& enemy);
-bool _segmentIntersectsAnyEnemy(double x1, double y1, double x2, double y2);
-bool _segmentIntersectsAnySelectEnemies(
-    double x1, double y1, double x2, double y2,
-    function<bool(const enemies::Enemy&)> selector
+void _castShadows(Shadows* shadows, double x, double y);
+void _enemyBins(
+    const Shadows& shadows, const enemies::Enemy& enemy, int* first, int* count
+);
+int _shadowBin(double dx, double dy);
+bool _isShadowed(
+    const Shadows& shadows, double x, double y, const enemies::Enemy* ignored
 );
 
+#ifdef __SSE2__
+__m128d _log(__m128d x);
+__m128d _exp(__m128d x);
+#endif
+
 // Heatmap used to determine the best waypoint to go to. Cooler (lower value)
-// is better.
-double _heatMap[_WAYPOINT_GRID_COLUMNS][_WAYPOINT_GRID_ROWS];
-double _waypointX[_WAYPOINT_GRID_COLUMNS][_WAYPOINT_GRID_ROWS];
-double _waypointY[_WAYPOINT_GRID_COLUMNS][_WAYPOINT_GRID_ROWS];
+// is better. It holds the heat of the world edges and the enemies, and is only
+// updated where enemies moved. The heat of the player and the bots, which
+// spans the whole map, is added when looking for the best waypoint. Cells are
+// stored by row, for the vector kernels to go through a row at a time.
+double _heatMap[_WAYPOINT_GRID_ROWS][_WAYPOINT_GRID_COLUMNS];
+double _edgesHeatMap[_WAYPOINT_GRID_ROWS][_WAYPOINT_GRID_COLUMNS];
+
+// Columns of the cells of each row to update, inclusive. Marking whole spans
+// might update cells in between that didn't need it, which is harmless.
+int _dirtyFirstColumn[_WAYPOINT_GRID_ROWS];
+int _dirtyLastColumn[_WAYPOINT_GRID_ROWS];
+
+// Waypoints are at the centers of the cells, so the waypoints of a column
+// share their x coordinate, and those of a row their y coordinate. They only
+// depend on the world size.
+double _waypointX[_WAYPOINT_GRID_COLUMNS];
+double _waypointY[_WAYPOINT_GRID_ROWS];
+
+// Minimum heat of the blocks of each level of the pyramid, by row, where blocks
+// of a level are of two by two blocks of the previous one. Level 0 is the heat
+// map itself, so it's left empty.
+vector<double> _heatPyramid[_HEAT_PYRAMID_LEVELS];
+
+// Enemy heat in the heat map, and the one to update it to, sorted by ID.
+vector<EnemyHeat> _enemyHeats;
+vector<EnemyHeat> _nextEnemyHeats;
+
+// World size the heat map was made for.
+int _heatMapWidth = 0;
+int _heatMapHeight = 0;
 
 double _maxDistance;
 bool _buffWasActive;
+Snapshot _snapshot;
 
 Bot _bots[BOTS_COUNT];
 bool _resetDone;
@@ -139,10 +283,9 @@ void update()
 
     _resetDone = false;
 
-    SDL_Window* window = smocc::getWindow();
     int ww, wh;
 
-    SDL_GetWindowSize(window, &ww, &wh);
+    smocc::getWorldSize(&ww, &wh);
 
     _maxDistance = gfx::distance(0, 0, ww, wh);
 
@@ -160,8 +303,13 @@ void update()
 
     if (buffIsAcive)
     {
-        _updateWaypoints();
         _updateHeatMap();
+        _takeSnapshot();
+
+        // Bots plan in parallel, each changing only itself. The rest of their
+        // update rolls numbers and moves bullet sources, so it's done after,
+        // in order.
+        workers::run(BOTS_COUNT, _planBot);
 
         for (int i = 0; i < BOTS_COUNT; i++)
         {
@@ -175,6 +323,26 @@ void update()
     _buffWasActive = buffIsAcive;
 }
 
+void render()
+{
+    if (!game::isRunning()) return;
+
+    double t = game::getInterpolation();
+
+    gfx::setDrawColor(&_BOT_COLOR);
+    gfx::setDrawBlendMode(SDL_BLENDMODE_BLEND);
+
+    for (int i = 0; i < BOTS_COUNT; i++)
+    {
+        if (!_bots[i].active) continue;
+
+        double x = lerp(_bots[i].previousX, _bots[i].x, t);
+        double y = lerp(_bots[i].previousY, _bots[i].y, t);
+
+        gfx::fillCircle(x, y, BOT_CIRCLE_RADIUS);
+    }
+}
+
 void location(unsigned int botIndex, double* x, double* y)
 {
     assert(botIndex < BOTS_COUNT);
@@ -206,114 +374,388 @@ void _reset()
 
 void _updateWaypoints()
 {
-    SDL_Window* window = smocc::getWindow();
     int ww, wh;
 
-    SDL_GetWindowSize(window, &ww, &wh);
+    smocc::getWorldSize(&ww, &wh);
 
     for (int c = 0; c < _WAYPOINT_GRID_COLUMNS; c++)
-        for (int r = 0; r < _WAYPOINT_GRID_ROWS; r++)
+        _waypointX[c] = (0.5 + c) / _WAYPOINT_GRID_COLUMNS * ww;
+
+    for (int r = 0; r < _WAYPOINT_GRID_ROWS; r++)
+        _waypointY[r] = (0.5 + r) / _WAYPOINT_GRID_ROWS * wh;
+}
+
+void _updateHeatMap()
+{
+    int ww, wh;
+
+    smocc::getWorldSize(&ww, &wh);
+
+    if (ww != _heatMapWidth || wh != _heatMapHeight) _resetHeatMap();
+
+    _nextEnemyHeats.clear();
+
+    for (const enemies::Enemy& enemy : enemies::all())
+        _nextEnemyHeats.push_back(_makeEnemyHeat(enemy));
+
+    auto byID = [](const EnemyHeat& a, const EnemyHeat& b)
+    { return a.id < b.id; };
+
+    sort(_nextEnemyHeats.begin(), _nextEnemyHeats.end(), byID);
+
+    // Marks the cells of the enemies that moved, appeared or disappeared,
+    // both where they were and where they are.
+    auto previous = _enemyHeats.begin();
+    auto next = _nextEnemyHeats.begin();
+
+    while (previous != _enemyHeats.end() || next != _nextEnemyHeats.end())
+    {
+        bool previousEnded = previous == _enemyHeats.end();
+        bool nextEnded = next == _nextEnemyHeats.end();
+
+        if (nextEnded || (!previousEnded && previous->id < next->id))
         {
-            double tx = (0.5 + (double)c) / _WAYPOINT_GRID_COLUMNS;
-            double ty = (0.5 + (double)r) / _WAYPOINT_GRID_ROWS;
+            _markHeatCells(*previous++);
+            continue;
+        }
 
-            _waypointX[c][r] = tx * ww;
-            _waypointY[c][r] = ty * wh;
+        if (previousEnded || next->id < previous->id)
+        {
+            _markHeatCells(*next++);
+            continue;
         }
+
+        if (_enemyHeatChanged(*previous, *next))
+        {
+            _markHeatCells(*previous);
+            _markHeatCells(*next);
+        }
+
+        previous++;
+        next++;
+    }
+
+    swap(_enemyHeats, _nextEnemyHeats);
+
+    int firstColumns[_WAYPOINT_GRID_ROWS];
+    int lastColumns[_WAYPOINT_GRID_ROWS];
+
+    // The dirty spans are cleared by updating the rows, but the pyramid needs
+    // them after.
+    copy(_dirtyFirstColumn, end(_dirtyFirstColumn), firstColumns);
+    copy(_dirtyLastColumn, end(_dirtyLastColumn), lastColumns);
+
+    // Rows are updated in parallel, as each only changes its own cells.
+    workers::run(_WAYPOINT_GRID_ROWS, _updateHeatRow);
+
+    _updatePyramid(firstColumns, lastColumns);
 }
 
-void _updateHeatMap()
+void _resetHeatMap()
 {
-    for (int c = 0; c < _WAYPOINT_GRID_COLUMNS; c++)
-        for (int r = 0; r < _WAYPOINT_GRID_ROWS; r++)
-            _updateHeatPoint(c, r);
+    smocc::getWorldSize(&_heatMapWidth, &_heatMapHeight);
+
+    _updateWaypoints();
+
+    for (int r = 0; r < _WAYPOINT_GRID_ROWS; r++)
+    {
+        for (int c = 0; c < _WAYPOINT_GRID_COLUMNS; c++)
+        {
+            double heat = _getWorldEdgesHeat(_waypointX[c], _waypointY[r]);
+
+            _edgesHeatMap[r][c] = heat;
+            _heatMap[r][c] = heat;
+        }
+
+        _dirtyFirstColumn[r] = _WAYPOINT_GRID_COLUMNS;
+        _dirtyLastColumn[r] = -1;
+    }
+
+    for (int level = 1; level < _HEAT_PYRAMID_LEVELS; level++)
+    {
+        int size = _pyramidColumns(level) * _pyramidRows(level);
+
+        _heatPyramid[level].assign(size, 0);
+    }
+
+    int firstColumns[_WAYPOINT_GRID_ROWS];
+    int lastColumns[_WAYPOINT_GRID_ROWS];
+
+    fill(begin(firstColumns), end(firstColumns), 0);
+    fill(begin(lastColumns), end(lastColumns), _WAYPOINT_GRID_COLUMNS - 1);
+
+    _updatePyramid(firstColumns, lastColumns);
+
+    // All the enemies are added again as if they just appeared.
+    _enemyHeats.clear();
 }
 
-void _updateHeatPoint(unsigned int col, unsigned int row)
+void _markHeatCells(const EnemyHeat& heat)
 {
-    double x = _waypointX[col][row];
-    double y = _waypointY[col][row];
+    for (int r = heat.firstRow; r <= heat.lastRow; r++)
+    {
+        int first = min(_dirtyFirstColumn[r], heat.firstColumn);
+        int last = max(_dirtyLastColumn[r], heat.lastColumn);
 
-    double* heat = &_heatMap[col][row];
+        _dirtyFirstColumn[r] = first;
+        _dirtyLastColumn[r] = last;
+    }
+}
 
-    *heat = 0;
+// Computes the heat of the marked cells of a row again, from the edges heat and
+// the heat of the enemies that reach them.
+void _updateHeatRow(int row)
+{
+    int first = _dirtyFirstColumn[row];
+    int last = _dirtyLastColumn[row];
 
-    double playerX = player::getXPosition();
-    double playerY = player::getYPosition();
-    double playerDistance = gfx::distance(x, y, playerX, playerY);
-    double playerHeat = playerDistance / _maxDistance;
+    if (first > last) return;
+
+    const double* edgesHeat = _edgesHeatMap[row];
+
+    copy(edgesHeat + first, edgesHeat + last + 1, _heatMap[row] + first);
+
+    for (const EnemyHeat& heat : _enemyHeats)
+    {
+        if (row < heat.firstRow || row > heat.lastRow) continue;
 
-    *heat += _getPlayerHeat(x, y);
-    *heat += _getWorldEdgesHeat(x, y);
+        int from = max(first, heat.firstColumn);
+        int to = min(last, heat.lastColumn);
 
-    enemies::forEach([&](auto e) { *heat += _getEnemyHeat(x, y, e); });
+        if (from <= to) _addEnemyHeatRow(heat, row, from, to);
+    }
+
+    _dirtyFirstColumn[row] = _WAYPOINT_GRID_COLUMNS;
+    _dirtyLastColumn[row] = -1;
 }
 
-double _getPlayerHeat(double x, double y)
+// Adds the heat of an enemy to the cells of a row from column `first` to
+// `last`.
+void _addEnemyHeatRow(const EnemyHeat& heat, int row, int first, int last)
 {
-    double playerX = player::getXPosition();
-    double playerY = player::getYPosition();
-    double distance = gfx::distance(x, y, playerX, playerY);
+    double* cells = _heatMap[row];
+    double y = _waypointY[row];
 
-    return _PLAYER_HEAT_FACTOR * _maxDistance / distance;
+    for (int c = first; c <= last; c++)
+        cells[c] += _getEnemyHeat(_waypointX[c], y, heat);
 }
 
-double _getBotHeat(double x, double y, unsigned int botIndex)
+// Adds the heat of a point to the cells of a row from column `first` to
+// `last`, two cells at a time.
+void _addPointHeatRow(double* cells, int row, int first, int last, PointHeat p)
 {
-    if (!_bots[botIndex].active) return 0;
+    double dy = _waypointY[row] - p.y;
+    double numerator = p.k * _maxDistance;
+    int c = first;
+
+#ifdef __SSE2__
+    __m128d xs = _mm_set1_pd(p.x);
+    __m128d dy2 = _mm_set1_pd(dy * dy);
+    __m128d numerators = _mm_set1_pd(numerator);
+
+    for (; c < last; c += 2)
+    {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(_waypointX + c), xs);
+        __m128d d = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), dy2));
+        __m128d h = _mm_div_pd(numerators, d);
+
+        _mm_storeu_pd(cells + c, _mm_add_pd(_mm_loadu_pd(cells + c), h));
+    }
+#endif
 
-    double botX = _bots[botIndex].x;
-    double botY = _bots[botIndex].y;
-    double distance = gfx::distance(x, y, botX, botY);
+    for (; c <= last; c++)
+    {
+        double dx = _waypointX[c] - p.x;
 
-    return _BOT_HEAT_FACTOR * _maxDistance / distance;
+        cells[c] += numerator / sqrt(dx * dx + dy * dy);
+    }
 }
 
-double _getWorldEdgesHeat(double x, double y)
+// Updates the blocks of the pyramid over the given spans of columns of the
+// rows of the heat map, inclusive, and empty where the first is past the last.
+void _updatePyramid(int* firstColumns, int* lastColumns)
 {
-    SDL_Window* window = smocc::getWindow();
-    int ww, wh;
+    const double* below = &_heatMap[0][0];
 
-    SDL_GetWindowSize(window, &ww, &wh);
+    for (int level = 1; level < _HEAT_PYRAMID_LEVELS; level++)
+    {
+        int belowColumns = _pyramidColumns(level - 1);
+        int belowRows = _pyramidRows(level - 1);
+        int columns = _pyramidColumns(level);
+        int rows = _pyramidRows(level);
+        double* blocks = _heatPyramid[level].data();
 
-    double maxEdgeDistance = min(ww, wh) / 2;
-    double distance = gfx::distancePointToRectOutline(x, y, 0, 0, ww, wh);
+        for (int r = 0; r < rows; r++)
+        {
+            int r1 = 2 * r;
+            int r2 = min(r1 + 1, belowRows - 1);
 
-    return _WORLD_EDGES_HEAT_FACTOR * _maxDistance / distance;
+            int first = min(firstColumns[r1], firstColumns[r2]);
+            int last = max(lastColumns[r1], lastColumns[r2]);
+
+            // Spans of this level are the halved spans of the rows below.
+            if (first <= last)
+            {
+                first /= 2;
+                last /= 2;
+            }
+
+            for (int c = first; c <= last; c++)
+            {
+                int c1 = 2 * c;
+                int c2 = min(c1 + 1, belowColumns - 1);
+
+                double top = min(below[r1 * belowColumns + c1],
+                                 below[r1 * belowColumns + c2]);
+                double bottom = min(below[r2 * belowColumns + c1],
+                                    below[r2 * belowColumns + c2]);
+
+                blocks[r * columns + c] = min(top, bottom);
+            }
+
+            firstColumns[r] = first;
+            lastColumns[r] = last;
+        }
+
+        below = blocks;
+    }
+}
+
+int _pyramidColumns(int level)
+{
+    return ((_WAYPOINT_GRID_COLUMNS - 1) >> level) + 1;
 }
 
-double _getEnemyHeat(double x, double y, const enemies::Enemy& enemy)
+int _pyramidRows(int level)
+{
+    return ((_WAYPOINT_GRID_ROWS - 1) >> level) + 1;
+}
+
+// Finds a lower bound for the heat of the cells of a block, from its minimum
+// heat map heat, and the heat of the given points at the far ends of the block.
+double _blockMinHeat(
+    int level, int row, int column, const PointHeat* sources, int sourceCount
+)
 {
-    double d = gfx::distance(x, y, enemy.x, enemy.y);
+    int columns = _pyramidColumns(level);
+    double heat = level == 0 ? _heatMap[row][column]
+                             : _heatPyramid[level][row * columns + column];
 
-    if (d < enemy.radius) return std::numeric_limits<double>::infinity();
+    int firstColumn = column << level;
+    int lastColumn = ((column + 1) << level) - 1;
+    int firstRow = row << level;
+    int lastRow = ((row + 1) << level) - 1;
+
+    lastColumn = min<int>(lastColumn, _WAYPOINT_GRID_COLUMNS - 1);
+    lastRow = min<int>(lastRow, _WAYPOINT_GRID_ROWS - 1);
+
+    for (int i = 0; i < sourceCount; i++)
+    {
+        const PointHeat& p = sources[i];
+
+        double dx = max(fabs(p.x - _waypointX[firstColumn]),
+                        fabs(p.x - _waypointX[lastColumn]));
+        double dy = max(fabs(p.y - _waypointY[firstRow]),
+                        fabs(p.y - _waypointY[lastRow]));
+
+        heat += p.k * _maxDistance / sqrt(dx * dx + dy * dy);
+    }
+
+    return heat;
+}
+
+EnemyHeat _makeEnemyHeat(const enemies::Enemy& enemy)
+{
+    EnemyHeat heat;
+
+    heat.id = enemy.id;
+    heat.x = enemy.x;
+    heat.y = enemy.y;
+    heat.radius = enemy.radius;
+    heat.health = enemy.health;
+    heat.speed = enemy.speed;
 
     double h = enemy.health;
     double s = enemy.speed;
 
-    double distanceFactor = _maxDistance / d;
     double healthFactor = lerp(1.0, 10.0, h / enemies::MAX_ENEMY_HEALTH);
     double speedFactor = lerp(1.0, 10.0, s / enemies::MAX_ENEMY_SPEED);
 
-    double base = distanceFactor * healthFactor * speedFactor;
-    double power = max(1.0, 1 + 10 * speedFactor - 10);
+    heat.scale = _maxDistance * healthFactor * speedFactor;
+    heat.power = max(1.0, 1 + 10 * speedFactor - 10);
+    heat.reach = enemy.radius + _ENEMY_HEAT_REACH_PIXELS;
+
+    double edgeHeat = pow(heat.scale / heat.reach, heat.power);
+
+    heat.offset = isfinite(edgeHeat) ? edgeHeat : 0;
+
+    // Waypoints are at the centers of the cells.
+    double cellWidth = (double)_heatMapWidth / _WAYPOINT_GRID_COLUMNS;
+    double cellHeight = (double)_heatMapHeight / _WAYPOINT_GRID_ROWS;
+    double firstColumn = ceil((enemy.x - heat.reach) / cellWidth - 0.5);
+    double lastColumn = floor((enemy.x + heat.reach) / cellWidth - 0.5);
+    double firstRow = ceil((enemy.y - heat.reach) / cellHeight - 0.5);
+    double lastRow = floor((enemy.y + heat.reach) / cellHeight - 0.5);
+
+    heat.firstColumn = max(firstColumn, 0.0);
+    heat.lastColumn = min<int>(lastColumn, _WAYPOINT_GRID_COLUMNS - 1.0);
+    heat.firstRow = max(firstRow, 0.0);
+    heat.lastRow = min<int>(lastRow, _WAYPOINT_GRID_ROWS - 1.0);
+
+    return heat;
+}
+
+bool _enemyHeatChanged(const EnemyHeat& a, const EnemyHeat& b)
+{
+    if (a.x != b.x || a.y != b.y || a.radius != b.radius) return true;
 
-    return _ENEMY_HEAT_FACTOR * pow(base, power);
+    return a.health != b.health || a.speed != b.speed || a.scale != b.scale;
+}
+
+double _getWorldEdgesHeat(double x, double y)
+{
+    int ww, wh;
+
+    smocc::getWorldSize(&ww, &wh);
+
+    double maxEdgeDistance = min(ww, wh) / 2;
+    double distance = gfx::distancePointToRectOutline(x, y, 0, 0, ww, wh);
+
+    return _WORLD_EDGES_HEAT_FACTOR * _maxDistance / distance;
+}
+
+double _getEnemyHeat(double x, double y, const EnemyHeat& heat)
+{
+    double dx = x - heat.x;
+    double dy = y - heat.y;
+    double d2 = dx * dx + dy * dy;
+
+    if (d2 < heat.radius * heat.radius)
+        return std::numeric_limits<double>::infinity();
+
+    if (d2 >= heat.reach * heat.reach) return 0;
+
+    double enemyHeat = pow(heat.scale / sqrt(d2), heat.power) - heat.offset;
+
+    return _ENEMY_HEAT_FACTOR * max(enemyHeat, 0.0);
 }
 
 void _activateBot(Bot& bot)
 {
-    SDL_Window* window = smocc::getWindow();
     int ww, wh;
 
-    SDL_GetWindowSize(window, &ww, &wh);
+    smocc::getWorldSize(&ww, &wh);
+
+    double rolls[5];
+
+    rng::fill(rng::BOTS, rolls, 5);
 
-    double aimRotationRadians = M_PI * rng::roll();
+    double aimRotationRadians = M_PI * rolls[0];
 
-    double px = rng::roll() * ww;
-    double py = rng::roll() * wh;
-    double ptx = rng::roll() * ww;
-    double pty = rng::roll() * wh;
+    double px = rolls[1] * ww;
+    double py = rolls[2] * wh;
+    double ptx = rolls[3] * ww;
+    double pty = rolls[4] * wh;
     double pdx, pdy;
 
     gfx::direction(px, py, ptx, pty, &pdx, &pdy);
@@ -321,6 +763,8 @@ void _activateBot(Bot& bot)
     bot.active = true;
     bot.x = player::getXPosition();
     bot.y = player::getYPosition();
+    bot.previousX = bot.x;
+    bot.previousY = bot.y;
     bot.poi.x = px;
     bot.poi.y = py;
     bot.poi.targetX = ptx;
@@ -333,20 +777,42 @@ void _activateBot(Bot& bot)
     bot.bulletSourceID = bullets::createSource();
 }
 
-void _updateBot(Bot& bot)
+void _takeSnapshot()
+{
+    _snapshot.enemies = enemies::all();
+    _snapshot.playerX = player::getXPosition();
+    _snapshot.playerY = player::getYPosition();
+
+    for (int i = 0; i < BOTS_COUNT; i++)
+    {
+        _snapshot.botX[i] = _bots[i].x;
+        _snapshot.botY[i] = _bots[i].y;
+        _snapshot.botActive[i] = _bots[i].active;
+    }
+}
+
+// Moves a bot toward its best waypoint and turns its aim to its best target,
+// from the snapshot, on a worker.
+void _planBot(int index)
 {
+    Bot& bot = _bots[index];
+
+    if (!bot.active) return;
+
     bot.reset = false;
+    bot.previousX = bot.x;
+    bot.previousY = bot.y;
 
     _updateBotPosition(bot);
-    _updateBotPointOfInterest(bot);
     _updateBotAim(bot);
+}
+
+void _updateBot(Bot& bot)
+{
+    _updateBotPointOfInterest(bot);
 
     bullets::setSourcePosition(bot.bulletSourceID, bot.x, bot.y);
     bullets::setSourceDirection(bot.bulletSourceID, bot.aim.x, bot.aim.y);
-
-    gfx::setDrawColor(&_BOT_COLOR);
-    gfx::setDrawBlendMode(SDL_BLENDMODE_BLEND);
-    gfx::fillCircle(bot.x, bot.y, BOT_CIRCLE_RADIUS);
 }
 
 void _resetBot(Bot& bot)
@@ -393,15 +859,14 @@ void _updateBotPointOfInterest(Bot& bot)
 
     if (poiPositionChange > gfx::distance(px, py, ptx, pty))
     {
-        SDL_Window* window = smocc::getWindow();
         int ww, wh;
 
-        SDL_GetWindowSize(window, &ww, &wh);
+        smocc::getWorldSize(&ww, &wh);
 
         px = ptx;
         py = pty;
-        ptx = rng::roll() * ww;
-        pty = rng::roll() * wh;
+        ptx = rng::roll(rng::BOTS) * ww;
+        pty = rng::roll(rng::BOTS) * wh;
 
         double pdx, pdy;
 
@@ -459,40 +924,133 @@ void _updateBotAim(Bot& bot)
     bot.aim.y = dy;
 }
 
+// Searches the pyramid from the top down, going into the blocks with the lower
+// bounds first, and leaving out the blocks that can't have a cell colder than
+// the coldest cell found so far.
 pair<unsigned int, unsigned int> _findBestWaypoint(Bot& bot)
 {
     double coldestHeat = std::numeric_limits<double>::infinity();
 
     pair<unsigned int, unsigned int> bestWaypoint = {bot.x, bot.y};
 
-    for (int c = 0; c < _WAYPOINT_GRID_COLUMNS; c++)
-        for (int r = 0; r < _WAYPOINT_GRID_ROWS; r++)
+    double poiDist = gfx::distance(bot.x, bot.y, bot.poi.x, bot.poi.y);
+    double t = 1 - (poiDist / _maxDistance);
+    double minFactor = 1.0 - _POI_PRIORITY_FACTOR;
+    double maxFactor = 1.0;
+    double factor = lerp(minFactor, maxFactor, t);
+
+    PointHeat sources[BOTS_COUNT];
+    int sourceCount = 0;
+
+    double playerX = _snapshot.playerX;
+    double playerY = _snapshot.playerY;
+
+    sources[sourceCount++] = {playerX, playerY, _PLAYER_HEAT_FACTOR};
+
+    for (int i = 0; i < BOTS_COUNT; i++)
+    {
+        if (i == bot.index || !_snapshot.botActive[i]) continue;
+
+        double x = _snapshot.botX[i];
+        double y = _snapshot.botY[i];
+
+        sources[sourceCount++] = {x, y, _BOT_HEAT_FACTOR};
+    }
+
+    _castShadows(&bot.shadows, bot.x, bot.y);
+
+    // Each block taken off the stack pushes at most four.
+    HeatBlock stack[4 * _HEAT_PYRAMID_LEVELS];
+    int stackSize = 0;
+    int top = _HEAT_PYRAMID_LEVELS - 1;
+
+    stack[stackSize++] = {top, 0, 0, 0};
+
+    while (stackSize > 0)
+    {
+        HeatBlock block = stack[--stackSize];
+
+        // The coldest heat might have gone down since the block was pushed.
+        if (block.minHeat * factor >= coldestHeat) continue;
+
+        if (block.level == 1)
         {
-            double wx = _waypointX[c][r];
-            double wy = _waypointY[c][r];
+            int firstColumn = 2 * block.column;
+            int lastColumn = firstColumn + 1;
+            int firstRow = 2 * block.row;
+            int lastRow = firstRow + 1;
+
+            lastColumn = min<int>(lastColumn, _WAYPOINT_GRID_COLUMNS - 1);
+            lastRow = min<int>(lastRow, _WAYPOINT_GRID_ROWS - 1);
+
+            for (int r = firstRow; r <= lastRow; r++)
+            {
+                double cells[_WAYPOINT_GRID_COLUMNS];
 
-            if (_segmentIntersectsAnyEnemy(bot.x, bot.y, wx, wy)) continue;
+                for (int c = firstColumn; c <= lastColumn; c++)
+                    cells[c] = _heatMap[r][c];
 
-            double heat = _heatMap[c][r];
+                for (int i = 0; i < sourceCount; i++)
+                {
+                    PointHeat source = sources[i];
 
-            for (int i = 0; i < BOTS_COUNT; i++)
-                if (i != bot.index) heat += _getBotHeat(wx, wy, i);
+                    _addPointHeatRow(cells, r, firstColumn, lastColumn, source);
+                }
 
-            double poiDist = gfx::distance(bot.x, bot.y, bot.poi.x, bot.poi.y);
-            double t = 1 - (poiDist / _maxDistance);
-            double minFactor = 1.0 - _POI_PRIORITY_FACTOR;
-            double maxFactor = 1.0;
-            double factor = lerp(minFactor, maxFactor, t);
+                for (int c = firstColumn; c <= lastColumn; c++)
+                {
+                    double heat = cells[c] * factor;
 
-            heat *= factor;
+                    if (heat >= coldestHeat) continue;
 
-            if (heat < coldestHeat)
+                    double wx = _waypointX[c];
+                    double wy = _waypointY[r];
+
+                    if (_isShadowed(bot.shadows, wx, wy, nullptr)) continue;
+
+                    coldestHeat = heat;
+                    bestWaypoint = {c, r};
+                }
+            }
+
+            continue;
+        }
+
+        HeatBlock children[4];
+        int childCount = 0;
+        int level = block.level - 1;
+
+        for (int r = 2 * block.row; r <= 2 * block.row + 1; r++)
+            for (int c = 2 * block.column; c <= 2 * block.column + 1; c++)
             {
-                coldestHeat = heat;
-                bestWaypoint = {c, r};
+                if (r >= _pyramidRows(level)) continue;
+                if (c >= _pyramidColumns(level)) continue;
+
+                double minHeat =
+                    _blockMinHeat(level, r, c, sources, sourceCount);
+
+                if (minHeat * factor >= coldestHeat) continue;
+
+                children[childCount++] = {level, r, c, minHeat};
             }
+
+        // Sorted from the hottest, by insertion as there are four at most, to
+        // be pushed so that the coldest is searched first.
+        for (int i = 1; i < childCount; i++)
+        {
+            HeatBlock child = children[i];
+            int j = i;
+
+            for (; j > 0 && children[j - 1].minHeat < child.minHeat; j--)
+                children[j] = children[j - 1];
+
+            children[j] = child;
         }
 
+        for (int i = 0; i < childCount; i++)
+            stack[stackSize++] = children[i];
+    }
+
     return bestWaypoint;
 }
 
@@ -501,18 +1059,18 @@ const enemies::Enemy* findBestTarget(Bot& bot)
     const enemies::Enemy* bestTarget = nullptr;
     double bestPriority = 0;
 
-    enemies::forEach(
-        [&](auto e)
-        {
-            double priority = getTargetPriority(bot, e);
+    _castShadows(&bot.shadows, bot.x, bot.y);
 
-            if (priority > bestPriority)
-            {
-                bestPriority = priority;
-                bestTarget = &e;
-            }
+    for (const enemies::Enemy& enemy : _snapshot.enemies)
+    {
+        double priority = getTargetPriority(bot, enemy);
+
+        if (priority > bestPriority)
+        {
+            bestPriority = priority;
+            bestTarget = &enemy;
         }
-    );
+    }
 
     return bestTarget;
 }
@@ -559,17 +1117,15 @@ void getDirectionToAim(
 
 double getTargetPriority(Bot& bot, const enemies::Enemy& enemy)
 {
-    double px = player::getXPosition();
-    double py = player::getYPosition();
+    double px = _snapshot.playerX;
+    double py = _snapshot.playerY;
     double bx = bot.x;
     double by = bot.y;
     double ex = enemy.x;
     double ey = enemy.y;
     double eh = enemy.health;
 
-    auto notEnemy = [&](auto e) { return e.id != enemy.id; };
-
-    if (_segmentIntersectsAnySelectEnemies(bx, by, ex, ey, notEnemy)) return 0;
+    if (_isShadowed(bot.shadows, ex, ey, &enemy)) return 0;
 
     double minHealth = enemies::MIN_ENEMY_HEALTH;
     double maxHealth = enemies::MAX_ENEMY_HEALTH;
@@ -582,34 +1138,141 @@ double getTargetPriority(Bot& bot, const enemies::Enemy& enemy)
     return distanceFactor * healthFactor;
 }
 
-bool _segmentIntersectsAnyEnemy(double x1, double y1, double x2, double y2)
+// Sorts the enemies into the bins of the directions in which they're seen from
+// the given point.
+void _castShadows(Shadows* shadows, double x, double y)
+{
+    span<const enemies::Enemy> all = _snapshot.enemies;
+
+    shadows->x = x;
+    shadows->y = y;
+
+    unsigned int* starts = shadows->binStarts;
+
+    fill(starts, starts + _SHADOW_BINS + 1, 0);
+    double* clearances = shadows->clearances;
+
+    fill(clearances, clearances + _SHADOW_BINS, numeric_limits<double>::max());
+
+    // Counts the enemies of each bin, and turns the counts into the starts of
+    // the bins, which are moved forward as the enemies are placed.
+    for (const enemies::Enemy& enemy : all)
+    {
+        int first, count;
+
+        _enemyBins(*shadows, enemy, &first, &count);
+
+        for (int i = 0; i < count; i++)
+            starts[(first + i) % _SHADOW_BINS + 1]++;
+    }
+
+    for (int bin = 0; bin < _SHADOW_BINS; bin++)
+        starts[bin + 1] += starts[bin];
+
+    shadows->enemies.resize(starts[_SHADOW_BINS]);
+
+    for (unsigned int e = 0; e < all.size(); e++)
+    {
+        int first, count;
+        double distance = gfx::distance(x, y, all[e].x, all[e].y);
+        double clearance = max(distance - all[e].radius, 0.0);
+
+        _enemyBins(*shadows, all[e], &first, &count);
+
+        for (int i = 0; i < count; i++)
+        {
+            int bin = (first + i) % _SHADOW_BINS;
+
+            shadows->enemies[starts[bin]++] = e;
+            clearances[bin] = min(clearances[bin], clearance);
+        }
+    }
+
+    // Placing the enemies moved the starts of the bins to their ends.
+    for (int bin = _SHADOW_BINS; bin > 0; bin--)
+        starts[bin] = starts[bin - 1];
+
+    starts[0] = 0;
+}
+
+// Finds the bins with directions that go through an enemy, widened by a bin on
+// each side, as bins are found from the rounded directions of the tangents.
+void _enemyBins(
+    const Shadows& shadows, const enemies::Enemy& enemy, int* first, int* count
+)
 {
-    return _segmentIntersectsAnySelectEnemies(
-        x1, y1, x2, y2, [](auto _) { return true; }
-    );
+    double dx = enemy.x - shadows.x;
+    double dy = enemy.y - shadows.y;
+    double distance = sqrt(dx * dx + dy * dy);
+
+    // Segments in any direction from inside an enemy intersect it.
+    if (distance <= enemy.radius)
+    {
+        *first = 0;
+        *count = _SHADOW_BINS;
+        return;
+    }
+
+    double sine = enemy.radius / distance;
+    double cosine = sqrt(1 - sine * sine);
+    double ux = dx / distance;
+    double uy = dy / distance;
+
+    // Directions of the tangents, rotated from the direction of the center.
+    int start = _shadowBin(ux * cosine + uy * sine, uy * cosine - ux * sine);
+    int end = _shadowBin(ux * cosine - uy * sine, uy * cosine + ux * sine);
+
+    *first = (start - 1 + _SHADOW_BINS) % _SHADOW_BINS;
+    *count = (end - start + _SHADOW_BINS) % _SHADOW_BINS + 3;
+}
+
+// Finds the bin of a direction from its pseudo angle, which grows with the
+// angle from 0 to 4 around the circle, and needs no trigonometry.
+int _shadowBin(double dx, double dy)
+{
+    double sum = fabs(dx) + fabs(dy);
+
+    if (sum == 0) return 0;
+
+    double p = dx / sum;
+    double angle = dy >= 0 ? 1 - p : 3 + p;
+    int bin = angle / 4 * _SHADOW_BINS;
+
+    return min(bin, _SHADOW_BINS - 1);
 }
 
-bool _segmentIntersectsAnySelectEnemies(
-    double x1, double y1, double x2, double y2,
-    function<bool(const enemies::Enemy&)> selector
+// Returns true if the segment from the point shadows were cast from to the
+// given one intersects an enemy, other than the ignored one.
+bool _isShadowed(
+    const Shadows& shadows, double x, double y, const enemies::Enemy* ignored
 )
 {
-    bool s = false;
+    double dx = x - shadows.x;
+    double dy = y - shadows.y;
+    int bin = _shadowBin(dx, dy);
+    double clearance = shadows.clearances[bin];
 
-    enemies::forEach(
-        [&](auto e)
-        {
-            if (!selector(e)) return;
+    if (dx * dx + dy * dy < clearance * clearance) return false;
 
-            double ex = e.x;
-            double ey = e.y;
-            double er = e.radius;
+    span<const enemies::Enemy> all = _snapshot.enemies;
 
-            s = s || gfx::segmentIntersectsCircle(x1, y1, x2, y2, ex, ey, er);
-        }
-    );
+    unsigned int start = shadows.binStarts[bin];
+    unsigned int end = shadows.binStarts[bin + 1];
+
+    for (unsigned int i = start; i < end; i++)
+    {
+        const enemies::Enemy& e = all[shadows.enemies[i]];
+
+        if (&e == ignored) continue;
+
+        double sx = shadows.x;
+        double sy = shadows.y;
+
+        if (gfx::segmentIntersectsCircle(sx, sy, x, y, e.x, e.y, e.radius))
+            return true;
+    }
 
-    return s;
+    return false;
 }
 
 } // namespace smocc::bots
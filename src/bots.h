@@ -21,6 +21,7 @@ const int BOTS_COUNT = 3;
 
 void init();
 void update();
+void render();
 
 bool isActive(unsigned int botIndex);
 void deactivate(unsigned int botIndex);
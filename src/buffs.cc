@@ -8,6 +8,7 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 
 */
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <random>
@@ -67,6 +68,7 @@ struct BuffDrop
     unsigned long long id;
     unsigned long long spawnTime;
     double x, y;
+    double previousX, previousY;
     double speedX, speedY;
 };
 
@@ -81,7 +83,7 @@ void _spawnBuff(double x, double y, double speedX, double speedY);
 void _updateBuffDrop(BuffDrop& buffDrop);
 void _updateBuffDropLinearMovement(BuffDrop& buffDrop);
 void _updateBuffDropMagneticEffect(BuffDrop& buffDrop);
-void _renderBuffDrop(BuffDrop& buffDrop);
+void _renderBuffDrop(BuffDrop& buffDrop, double t, double time);
 void _rollBuff();
 
 void init()
@@ -99,9 +101,6 @@ void update()
 
     _resetDone = false;
 
-    gfx::setDrawColor(&_BUFF_COLOR);
-    gfx::setDrawBlendMode(SDL_BLENDMODE_BLEND);
-
     unsigned int deltaTime = game::getDeltaTimeMilliseconds();
 
     for (BuffType buff : BUFF_TYPES)
@@ -115,11 +114,41 @@ void update()
 
     for (auto id : _toDespawn)
         _buffDrops.erase(id);
+
+    _toDespawn.clear();
+}
+
+void render()
+{
+    if (!game::isRunning()) return;
+
+    double t = game::getInterpolation();
+    double time = game::getInterpolatedTimeElapsedMilliseconds();
+
+    gfx::setDrawColor(&_BUFF_COLOR);
+    gfx::setDrawBlendMode(SDL_BLENDMODE_BLEND);
+
+    for (auto& [_, buff] : _buffDrops)
+        _renderBuffDrop(buff, t, time);
 }
 
 void rollSpawn(double x, double y, double speedX, double speedY)
 {
-    if (rng::roll() < _BUFF_DROP_SPAWN_CHANCE) _spawnBuff(x, y, speedX, speedY);
+    double roll = rng::roll(rng::BUFFS);
+
+    if (roll < _BUFF_DROP_SPAWN_CHANCE) _spawnBuff(x, y, speedX, speedY);
+}
+
+void activate(BuffType type)
+{
+    _timeLeftMilliseconds[type] += BUFF_DURATION_MILLISECONDS;
+
+    cout << "Applied buff: " << getTitle(type) << endl;
+}
+
+void deactivate(BuffType type)
+{
+    _timeLeftMilliseconds[type] = 0;
 }
 
 bool isActive(BuffType type)
@@ -156,6 +185,8 @@ void _spawnBuff(double x, double y, double speedX, double speedY)
     buffDrop.spawnTime = game::getTimeElapsedMilliseconds();
     buffDrop.x = x;
     buffDrop.y = y;
+    buffDrop.previousX = x;
+    buffDrop.previousY = y;
     buffDrop.speedX = speedX;
     buffDrop.speedY = speedY;
 
@@ -164,6 +195,9 @@ void _spawnBuff(double x, double y, double speedX, double speedY)
 
 void _updateBuffDrop(BuffDrop& buffDrop)
 {
+    buffDrop.previousX = buffDrop.x;
+    buffDrop.previousY = buffDrop.y;
+
     double boundX = buffDrop.x - _BUFF_DROP_BOUNDING_RADIUS;
     double boundY = buffDrop.y - _BUFF_DROP_BOUNDING_RADIUS;
     double boundWH = _BUFF_DROP_BOUNDING_RADIUS * 2;
@@ -188,7 +222,6 @@ void _updateBuffDrop(BuffDrop& buffDrop)
 
     _updateBuffDropLinearMovement(buffDrop);
     _updateBuffDropMagneticEffect(buffDrop);
-    _renderBuffDrop(buffDrop);
 }
 
 void _updateBuffDropLinearMovement(BuffDrop& buffDrop)
@@ -221,10 +254,11 @@ void _updateBuffDropMagneticEffect(BuffDrop& buffDrop)
     buffDrop.y += dy * change;
 }
 
-void _renderBuffDrop(BuffDrop& buffDrop)
+void _renderBuffDrop(BuffDrop& buffDrop, double t, double time)
 {
-    unsigned long long start = buffDrop.spawnTime;
-    unsigned long long elapsed = game::getTimeElapsedMilliseconds() - start;
+    double x = lerp(buffDrop.previousX, buffDrop.x, t);
+    double y = lerp(buffDrop.previousY, buffDrop.y, t);
+    double elapsed = max(time - buffDrop.spawnTime, 0.0);
 
     double animationElapsed = remainder(
         elapsed, _BUFF_DROP_ROTATION_ANIMATION_TIME_INTERVAL_MILLISECONDS
@@ -254,8 +288,8 @@ void _renderBuffDrop(BuffDrop& buffDrop)
 
         gfx::rotate(sx, sy, squareRotationX, squareRotationY, &rx, &ry);
 
-        polygonX[i] = buffDrop.x + rx;
-        polygonY[i] = buffDrop.y + ry;
+        polygonX[i] = x + rx;
+        polygonY[i] = y + ry;
     }
 
     gfx::fillPolygon(polygonX, polygonY, 4);
@@ -263,13 +297,12 @@ void _renderBuffDrop(BuffDrop& buffDrop)
 
 void _rollBuff()
 {
-    // BuffType type = BUFF_TYPES[rng::rollInt(0, BUFF_TYPES_COUNT - 1)];
+    // int i = rng::rollInt(rng::BUFFS, 0, BUFF_TYPES_COUNT - 1);
+    // BuffType type = BUFF_TYPES[i];
 
     BuffType type = FRIENDLY_BOTS;
 
-    _timeLeftMilliseconds[type] += BUFF_DURATION_MILLISECONDS;
-
-    cout << "Applied buff: " << getTitle(type) << endl;
+    activate(type);
 }
 
 } // namespace smocc::buffs
\ No newline at end of file
@@ -36,7 +36,12 @@ const unsigned int BUFF_TYPES_COUNT = sizeof(BUFF_TYPES) / sizeof(BuffType);
 
 void init();
 void update();
+void render();
 void rollSpawn(double x, double y, double speedX, double speedY);
+// Applies the buff for its duration, adding to the time left if active.
+void activate(BuffType type);
+
+void deactivate(BuffType type);
 bool isActive(BuffType type);
 unsigned int getTimeLeftMilliseconds(BuffType type);
 char* getTitle(BuffType type);
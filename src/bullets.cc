@@ -14,6 +14,7 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 #include <limits>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <SDL.h>
 
@@ -23,6 +24,7 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 #include "enemies.h"
 #include "game.h"
 #include "gfx.h"
+#include "handles.h"
 #include "smocc.h"
 
 using namespace std;
@@ -60,13 +62,36 @@ struct BulletSource
     bool despawning;
 };
 
+// Live bullets stored as parallel arrays, indexed by a dense bullet index.
+// Bullets are referred to from outside by generational handles, so despawned
+// bullets can be swap-removed without invalidating the IDs of the others.
+struct BulletPool
+{
+    std::vector<unsigned long long> id;
+
+    std::vector<double> xBase;
+    std::vector<double> yBase;
+    std::vector<double> xTip;
+    std::vector<double> yTip;
+    std::vector<double> xPreviousTip;
+    std::vector<double> yPreviousTip;
+    std::vector<double> xDirection;
+    std::vector<double> yDirection;
+    std::vector<double> xSpeed;
+    std::vector<double> ySpeed;
+
+    std::vector<bool> despawning;
+
+    handles::Table handles;
+};
+
 unordered_map<unsigned long long, BulletSource> _sources;
 unordered_set<unsigned long long> _sourcesToDelete;
 
-unordered_map<unsigned long long, Bullet> _bullets;
-unordered_set<unsigned long long> _bulletsToDespawn;
+BulletPool _bullets;
+unsigned int _bulletsToDespawnCount;
 
-unsigned long long _nextID;
+unsigned long long _nextSourceID;
 bool _resetDone;
 
 double _tripleFireLeftBulletDirectionX;
@@ -78,7 +103,10 @@ void _updateSource(BulletSource& source);
 void _fire(double x, double y, double xDirection, double yDirection);
 void _spawn(double, double, double, double);
 void _reset();
-void _updateBullet(Bullet& bullet);
+void _updateBullet(unsigned int index);
+void _removeBullet(unsigned int index);
+void _compactBullets();
+Bullet _getBullet(unsigned int index);
 const enemies::Enemy* _findClosestEnemy(double, double);
 
 void init()
@@ -109,32 +137,46 @@ void update()
     for (auto& [_, source] : _sources)
         _updateSource(source);
 
-    for (auto& [id, bullet] : _bullets)
-        _updateBullet(bullet);
+    unsigned int bulletsCount = _bullets.id.size();
+
+    for (unsigned int i = 0; i < bulletsCount; i++)
+        _updateBullet(i);
 
     for (unsigned int id : _sourcesToDelete)
         _sources.erase(id);
 
-    for (unsigned long long id : _bulletsToDespawn)
-        _bullets.erase(id);
-
     _sourcesToDelete.clear();
-    _bulletsToDespawn.clear();
+    _compactBullets();
+}
+
+void render()
+{
+    if (!game::isRunning()) return;
 
     bool doubleDamage = buffs::isActive(DOUBLE_DAMAGE);
     SDL_Color* c = doubleDamage ? &_DOUBLE_DAMAGE_BULLET_COLOR : &_BULLET_COLOR;
 
     gfx::setDrawColor(c);
 
-    for (auto& [id, bullet] : _bullets)
-        gfx::drawLine(bullet.xBase, bullet.yBase, bullet.xTip, bullet.yTip);
+    double t = game::getInterpolation();
+    unsigned int bulletsCount = _bullets.id.size();
+
+    for (unsigned int i = 0; i < bulletsCount; i++)
+    {
+        double xTip = lerp(_bullets.xPreviousTip[i], _bullets.xTip[i], t);
+        double yTip = lerp(_bullets.yPreviousTip[i], _bullets.yTip[i], t);
+        double xBase = xTip - _bullets.xDirection[i] * _BULLET_LENGTH;
+        double yBase = yTip - _bullets.yDirection[i] * _BULLET_LENGTH;
+
+        gfx::drawLine(xBase, yBase, xTip, yTip);
+    }
 }
 
 unsigned long long createSource()
 {
     BulletSource source;
 
-    source.id = _nextID++;
+    source.id = _nextSourceID++;
     source.fireCooldown = _BULLETS_SPAWN_DELAY_MILLISECONDS;
     source.x = 0;
     source.y = 0;
@@ -162,6 +204,10 @@ void setSourceDirection(unsigned long long sourceID, double dx, double dy)
 
 void deleteSource(unsigned long long sourceID)
 {
+    // Sources are already gone when deleted after a reset, e.g. by the player
+    // despawning at the end of the game.
+    if (!_sources.contains(sourceID)) return;
+
     _sources[sourceID].despawning = true;
     _sourcesToDelete.insert(sourceID);
 }
@@ -236,44 +282,155 @@ void _fire(double x, double y, double xDirection, double yDirection)
 
 void _spawn(double x, double y, double xDirection, double yDirection)
 {
-    Bullet bullet;
-    bullet.id = _nextID++;
-    bullet.xBase = x;
-    bullet.yBase = y;
-    bullet.xTip = x + xDirection * _BULLET_LENGTH;
-    bullet.yTip = y + yDirection * _BULLET_LENGTH;
-    bullet.xDirection = xDirection;
-    bullet.yDirection = yDirection;
-    bullet.xSpeed = xDirection * BULLET_SPEED;
-    bullet.ySpeed = yDirection * BULLET_SPEED;
-    bullet.despawning = false;
-
-    _bullets[bullet.id] = bullet;
+    unsigned int index = _bullets.id.size();
+
+    _bullets.id.push_back(handles::acquire(_bullets.handles, index));
+    _bullets.xBase.push_back(x);
+    _bullets.yBase.push_back(y);
+    _bullets.xTip.push_back(x + xDirection * _BULLET_LENGTH);
+    _bullets.yTip.push_back(y + yDirection * _BULLET_LENGTH);
+    _bullets.xPreviousTip.push_back(_bullets.xTip.back());
+    _bullets.yPreviousTip.push_back(_bullets.yTip.back());
+    _bullets.xDirection.push_back(xDirection);
+    _bullets.yDirection.push_back(yDirection);
+    _bullets.xSpeed.push_back(xDirection * BULLET_SPEED);
+    _bullets.ySpeed.push_back(yDirection * BULLET_SPEED);
+    _bullets.despawning.push_back(false);
+}
+
+void spawn(double x, double y, double xDirection, double yDirection)
+{
+    assert(gfx::isUnitVector(xDirection, yDirection, 0.01));
+
+    _spawn(x, y, xDirection, yDirection);
+}
+
+unsigned int count()
+{
+    return _bullets.id.size();
 }
 
 void despawn(unsigned long long id)
 {
-    _bullets[id].despawning = true;
-    _bulletsToDespawn.insert(id);
+    unsigned int index;
+
+    if (!handles::resolve(_bullets.handles, id, &index)) return;
+    if (_bullets.despawning[index]) return;
+
+    _bullets.despawning[index] = true;
+    _bulletsToDespawnCount++;
 }
 
 void forEach(std::function<void(const Bullet& bullet)> callback)
 {
-    for (auto& [_, bullet] : _bullets)
-        callback(bullet);
+    unsigned int bulletsCount = _bullets.id.size();
+
+    for (unsigned int i = 0; i < bulletsCount; i++)
+        callback(_getBullet(i));
 }
 
 void _reset()
 {
-    _bullets.clear();
-    _bulletsToDespawn.clear();
+    _bullets.id.clear();
+    _bullets.xBase.clear();
+    _bullets.yBase.clear();
+    _bullets.xTip.clear();
+    _bullets.yTip.clear();
+    _bullets.xPreviousTip.clear();
+    _bullets.yPreviousTip.clear();
+    _bullets.xDirection.clear();
+    _bullets.yDirection.clear();
+    _bullets.xSpeed.clear();
+    _bullets.ySpeed.clear();
+    _bullets.despawning.clear();
+    handles::clear(_bullets.handles);
+    _bulletsToDespawnCount = 0;
     _sources.clear();
     _sourcesToDelete.clear();
-    _nextID = 0;
+    _nextSourceID = 0;
 
     _resetDone = true;
 }
 
+void _removeBullet(unsigned int index)
+{
+    unsigned int last = _bullets.id.size() - 1;
+
+    handles::release(_bullets.handles, _bullets.id[index]);
+
+    if (index != last)
+    {
+        handles::relocate(_bullets.handles, _bullets.id[last], index);
+
+        _bullets.id[index] = _bullets.id[last];
+        _bullets.xBase[index] = _bullets.xBase[last];
+        _bullets.yBase[index] = _bullets.yBase[last];
+        _bullets.xTip[index] = _bullets.xTip[last];
+        _bullets.yTip[index] = _bullets.yTip[last];
+        _bullets.xPreviousTip[index] = _bullets.xPreviousTip[last];
+        _bullets.yPreviousTip[index] = _bullets.yPreviousTip[last];
+        _bullets.xDirection[index] = _bullets.xDirection[last];
+        _bullets.yDirection[index] = _bullets.yDirection[last];
+        _bullets.xSpeed[index] = _bullets.xSpeed[last];
+        _bullets.ySpeed[index] = _bullets.ySpeed[last];
+        _bullets.despawning[index] = _bullets.despawning[last];
+    }
+
+    _bullets.id.pop_back();
+    _bullets.xBase.pop_back();
+    _bullets.yBase.pop_back();
+    _bullets.xTip.pop_back();
+    _bullets.yTip.pop_back();
+    _bullets.xPreviousTip.pop_back();
+    _bullets.yPreviousTip.pop_back();
+    _bullets.xDirection.pop_back();
+    _bullets.yDirection.pop_back();
+    _bullets.xSpeed.pop_back();
+    _bullets.ySpeed.pop_back();
+    _bullets.despawning.pop_back();
+}
+
+// Swap-removes all bullets marked for despawning.
+void _compactBullets()
+{
+    unsigned int i = 0;
+
+    while (_bulletsToDespawnCount > 0 && i < _bullets.id.size())
+    {
+        if (!_bullets.despawning[i])
+        {
+            i++;
+            continue;
+        }
+
+        // The bullet moved into this index needs checking too, so `i` stays.
+        _removeBullet(i);
+        _bulletsToDespawnCount--;
+    }
+
+    assert(_bulletsToDespawnCount == 0);
+}
+
+Bullet _getBullet(unsigned int index)
+{
+    Bullet bullet;
+
+    bullet.id = _bullets.id[index];
+    bullet.xBase = _bullets.xBase[index];
+    bullet.yBase = _bullets.yBase[index];
+    bullet.xTip = _bullets.xTip[index];
+    bullet.yTip = _bullets.yTip[index];
+    bullet.xPreviousTip = _bullets.xPreviousTip[index];
+    bullet.yPreviousTip = _bullets.yPreviousTip[index];
+    bullet.xDirection = _bullets.xDirection[index];
+    bullet.yDirection = _bullets.yDirection[index];
+    bullet.xSpeed = _bullets.xSpeed[index];
+    bullet.ySpeed = _bullets.ySpeed[index];
+    bullet.despawning = _bullets.despawning[index];
+
+    return bullet;
+}
+
 void _updateSource(BulletSource& source)
 {
     if (source.despawning) return;
@@ -293,34 +450,48 @@ void _updateSource(BulletSource& source)
     }
 }
 
-void _updateBullet(Bullet& bullet)
+void _updateBullet(unsigned int index)
 {
+    double& xBase = _bullets.xBase[index];
+    double& yBase = _bullets.yBase[index];
+    double& xTip = _bullets.xTip[index];
+    double& yTip = _bullets.yTip[index];
+    double& xPreviousTip = _bullets.xPreviousTip[index];
+    double& yPreviousTip = _bullets.yPreviousTip[index];
+    double& xDirection = _bullets.xDirection[index];
+    double& yDirection = _bullets.yDirection[index];
+    double& xSpeed = _bullets.xSpeed[index];
+    double& ySpeed = _bullets.ySpeed[index];
+
     double deltaTime = game::getDeltaTimeMilliseconds();
 
-    double xChange = bullet.xSpeed * deltaTime;
-    double yChange = bullet.ySpeed * deltaTime;
+    double xChange = xSpeed * deltaTime;
+    double yChange = ySpeed * deltaTime;
 
     const enemies::Enemy* enemyToFollow = nullptr;
     bool shouldRotateToEnemy = false;
     double ex, ey;   // position of enemy to follow
     double exd, eyd; // direction from bullet to enemy to follow
-    double xd = bullet.xDirection;
-    double yd = bullet.yDirection;
+    double xd = xDirection;
+    double yd = yDirection;
 
-    bullet.xBase += xChange;
-    bullet.yBase += yChange;
-    bullet.xTip += xChange;
-    bullet.yTip += yChange;
+    xPreviousTip = xTip;
+    yPreviousTip = yTip;
+
+    xBase += xChange;
+    yBase += yChange;
+    xTip += xChange;
+    yTip += yChange;
 
     if (buffs::isActive(FOLLOW_ENEMIES))
-        enemyToFollow = _findClosestEnemy(bullet.xTip, bullet.yTip);
+        enemyToFollow = _findClosestEnemy(xTip, yTip);
 
     if (enemyToFollow != nullptr)
     {
         ex = enemyToFollow->x;
         ey = enemyToFollow->y;
 
-        gfx::direction(bullet.xBase, bullet.yBase, ex, ey, &exd, &eyd);
+        gfx::direction(xBase, yBase, ex, ey, &exd, &eyd);
 
         double difference = abs(xd - exd) + abs(yd - eyd);
 
@@ -349,12 +520,12 @@ void _updateBullet(Bullet& bullet)
             yd = eyd;
         }
 
-        bullet.xDirection = xd;
-        bullet.yDirection = yd;
-        bullet.xSpeed = xd * BULLET_SPEED;
-        bullet.ySpeed = yd * BULLET_SPEED;
-        bullet.xTip = bullet.xBase + xd * _BULLET_LENGTH;
-        bullet.yTip = bullet.yBase + yd * _BULLET_LENGTH;
+        xDirection = xd;
+        yDirection = yd;
+        xSpeed = xd * BULLET_SPEED;
+        ySpeed = yd * BULLET_SPEED;
+        xTip = xBase + xd * _BULLET_LENGTH;
+        yTip = yBase + yd * _BULLET_LENGTH;
     }
 
     bool bouncingBuffActive = buffs::isActive(BOUNCING_BULLETS);
@@ -363,32 +534,32 @@ void _updateBullet(Bullet& bullet)
 
     if (buffs::isActive(BOUNCING_BULLETS))
     {
-        SDL_Window* win = smocc::getWindow();
         int w, h;
-        SDL_GetWindowSize(win, &w, &h);
 
-        bouncingHorizontally = bullet.xTip < 0 || bullet.xTip > w;
-        bouncingVertically = bullet.yTip < 0 || bullet.yTip > h;
+        smocc::getWorldSize(&w, &h);
+
+        bouncingHorizontally = xTip < 0 || xTip > w;
+        bouncingVertically = yTip < 0 || yTip > h;
     }
 
     if (bouncingHorizontally)
     {
-        bullet.xDirection = -bullet.xDirection;
-        bullet.xSpeed = -bullet.xSpeed;
-        bullet.xTip = bullet.xBase + bullet.xDirection * _BULLET_LENGTH;
+        xDirection = -xDirection;
+        xSpeed = -xSpeed;
+        xTip = xBase + xDirection * _BULLET_LENGTH;
     }
 
     if (bouncingVertically)
     {
-        bullet.yDirection = -bullet.yDirection;
-        bullet.ySpeed = -bullet.ySpeed;
-        bullet.yTip = bullet.yBase + bullet.yDirection * _BULLET_LENGTH;
+        yDirection = -yDirection;
+        ySpeed = -ySpeed;
+        yTip = yBase + yDirection * _BULLET_LENGTH;
     }
 
     bool shouldDespawn =
-        !bouncingBuffActive && !gfx::pointOnScreen(bullet.xBase, bullet.yBase);
+        !bouncingBuffActive && !gfx::pointOnScreen(xBase, yBase);
 
-    if (shouldDespawn) despawn(bullet.id);
+    if (shouldDespawn) despawn(_bullets.id[index]);
 }
 
 // Returns nullptr if no enemies are present.
@@ -397,20 +568,18 @@ const enemies::Enemy* _findClosestEnemy(double x, double y)
     const enemies::Enemy* closestEnemy = nullptr;
     double closestDistance = numeric_limits<double>::max();
 
-    enemies::forEach(
-        [&](const enemies::Enemy& enemy)
+    for (const enemies::Enemy& enemy : enemies::all())
+    {
+        double dx = x - enemy.x;
+        double dy = y - enemy.y;
+        double distance = dx * dx + dy * dy;
+
+        if (distance < closestDistance)
         {
-            double dx = x - enemy.x;
-            double dy = y - enemy.y;
-            double distance = dx * dx + dy * dy;
-
-            if (distance < closestDistance)
-            {
-                closestDistance = distance;
-                closestEnemy = &enemy;
-            }
+            closestDistance = distance;
+            closestEnemy = &enemy;
         }
-    );
+    }
 
     return closestEnemy;
 }
@@ -26,6 +26,12 @@ struct Bullet
     double yBase;
     double xTip;
     double yTip;
+
+    // Tip position before the last update, so that collisions can be checked
+    // along the whole path travelled by the bullet in that update.
+    double xPreviousTip;
+    double yPreviousTip;
+
     double xDirection;
     double yDirection;
     double xSpeed;
@@ -36,12 +42,18 @@ struct Bullet
 
 void init();
 void update();
+void render();
 
 unsigned long long createSource();
 void setSourcePosition(unsigned long long sourceID, double x, double y);
 void setSourceDirection(unsigned long long sourceID, double dx, double dy);
 void deleteSource(unsigned long long sourceID);
 
+// Spawns a bullet with its base at the given position, without a source.
+void spawn(double x, double y, double xDirection, double yDirection);
+
+unsigned int count();
+
 void despawn(unsigned long long id);
 void forEach(std::function<void(const Bullet& bullet)> callback);
 
@@ -0,0 +1,292 @@
+/*
+
+capture.cc: Frame capture for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#include <SDL.h>
+#include <SDL_image.h>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "capture.h"
+#include "smocc.h"
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+namespace smocc::capture
+{
+
+const char* _RAW_EXTENSION = ".raw";
+
+struct Frame
+{
+    unsigned long long number;
+    vector<Uint32> pixels;
+};
+
+bool _capturing = false;
+bool _raw;
+fs::path _path;
+ofstream _rawFile;
+int _width;
+int _height;
+
+// Frames go from the free buffers to the queue when read back, and back to
+// the free buffers when written, so the game loop never waits for the worker,
+// and only allocates when starting.
+mutex _mutex;
+condition_variable _queued;
+deque<Frame> _queue;
+vector<Frame> _freeFrames;
+bool _stopping;
+thread _worker;
+
+// Why the worker stopped writing frames, if it failed to. Errors are reported
+// by the game loop, which is the one to stop capturing.
+string _error;
+
+unsigned long long _frames;
+unsigned long long _dropped;
+
+void _work();
+bool _write(Frame* frame);
+bool _failed();
+
+void start(const char* path)
+{
+    SDL_Renderer* renderer = smocc::getRenderer();
+
+    if (SDL_GetRendererOutputSize(renderer, &_width, &_height))
+    {
+        cerr << "Failed to get renderer output size: " << SDL_GetError()
+             << endl;
+        exit(1);
+    }
+
+    _path = path;
+    _raw = _path.extension() == _RAW_EXTENSION;
+
+    if (_raw)
+    {
+        _rawFile.open(_path, ios::binary | ios::trunc);
+
+        if (!_rawFile)
+        {
+            cerr << "Failed to open capture file: " << path << endl;
+            exit(1);
+        }
+    }
+    else
+    {
+        error_code error;
+
+        fs::create_directories(_path, error);
+
+        if (error)
+        {
+            cerr << "Failed to create capture directory: " << path << endl;
+            exit(1);
+        }
+    }
+
+    _freeFrames.resize(QUEUE_CAPACITY);
+
+    for (Frame& frame : _freeFrames)
+        frame.pixels.resize(_width * _height);
+
+    _frames = 0;
+    _dropped = 0;
+    _error.clear();
+    _stopping = false;
+    _capturing = true;
+    _worker = thread(_work);
+}
+
+bool isCapturing()
+{
+    return _capturing;
+}
+
+void frame()
+{
+    if (!_capturing) return;
+
+    if (_failed())
+    {
+        stop();
+        return;
+    }
+
+    Frame frame;
+
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        if (_freeFrames.empty())
+        {
+            _dropped++;
+            return;
+        }
+
+        frame = move(_freeFrames.back());
+        _freeFrames.pop_back();
+    }
+
+    // SDL has no asynchronous readback, so this copy is the only part of the
+    // capture that happens on the game loop.
+    int res = SDL_RenderReadPixels(
+        smocc::getRenderer(), NULL, SDL_PIXELFORMAT_ARGB8888,
+        frame.pixels.data(), _width * sizeof(Uint32)
+    );
+
+    if (res)
+    {
+        cerr << "Failed to read back frame: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    frame.number = _frames++;
+
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        _queue.push_back(move(frame));
+    }
+
+    _queued.notify_one();
+}
+
+void stop()
+{
+    if (!_capturing) return;
+
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        _stopping = true;
+    }
+
+    _queued.notify_one();
+    _worker.join();
+
+    if (_raw) _rawFile.close();
+
+    _capturing = false;
+    _freeFrames.clear();
+    _queue.clear();
+
+    if (!_error.empty()) cerr << _error << endl;
+
+    cout << "Captured " << _frames << " frames of " << _width << "x";
+    cout << _height << " to " << _path.string() << ", dropped " << _dropped;
+    cout << endl;
+}
+
+void _work()
+{
+    while (true)
+    {
+        Frame frame;
+
+        {
+            unique_lock<mutex> lock(_mutex);
+
+            _queued.wait(lock, [] { return _stopping || !_queue.empty(); });
+
+            // Writes all the queued frames before stopping.
+            if (_queue.empty()) return;
+
+            frame = move(_queue.front());
+            _queue.pop_front();
+        }
+
+        bool written = _write(&frame);
+
+        {
+            lock_guard<mutex> lock(_mutex);
+
+            _freeFrames.push_back(move(frame));
+
+            // Frames still queued are left unwritten.
+            if (!written) return;
+        }
+    }
+}
+
+// Writes a frame, or saves the error and returns false if it fails to. Errors
+// aren't reported here, as exiting from the worker would tear down the game
+// while the game loop still runs.
+bool _write(Frame* frame)
+{
+    if (_raw)
+    {
+        const char* data = (const char*)frame->pixels.data();
+
+        _rawFile.write(data, frame->pixels.size() * sizeof(Uint32));
+
+        if (!_rawFile)
+        {
+            lock_guard<mutex> lock(_mutex);
+
+            _error = "Failed to write capture file: " + _path.string();
+            return false;
+        }
+
+        return true;
+    }
+
+    char name[32];
+
+    snprintf(name, sizeof(name), "%06llu.png", frame->number);
+
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(
+        frame->pixels.data(), _width, _height, 32, _width * sizeof(Uint32),
+        SDL_PIXELFORMAT_ARGB8888
+    );
+
+    if (!surface)
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        _error = string("Failed to create frame surface: ") + SDL_GetError();
+        return false;
+    }
+
+    bool saved = !IMG_SavePNG(surface, (_path / name).string().c_str());
+
+    SDL_FreeSurface(surface);
+
+    if (!saved)
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        _error = string("Failed to save frame: ") + IMG_GetError();
+        return false;
+    }
+
+    return true;
+}
+
+bool _failed()
+{
+    lock_guard<mutex> lock(_mutex);
+
+    return !_error.empty();
+}
+
+} // namespace smocc::capture
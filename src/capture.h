@@ -0,0 +1,36 @@
+/*
+
+capture.h: Frame capture for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#pragma once
+
+namespace smocc::capture
+{
+
+// Maximum number of frames read back and waiting to be written. Frames
+// presented while all of them are waiting are dropped.
+const unsigned int QUEUE_CAPACITY = 8;
+
+// Starts capturing the presented frames. A path ending in `.raw` gets all the
+// frames as raw video, in 32 bit BGRA pixels, any other path is a directory
+// that gets a sequence of PNG images. Frames are encoded and written on a
+// worker thread.
+void start(const char* path);
+
+bool isCapturing();
+
+// Reads back the frame about to be presented, and queues it for writing. If
+// the worker failed to write a frame, reports the error and stops capturing.
+void frame();
+
+// Writes the queued frames, waits for the worker to finish, and prints how
+// many frames were captured and dropped.
+void stop();
+
+} // namespace smocc::capture
@@ -11,8 +11,8 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 #include <cmath>
 #include <iostream>
 #include <random>
-#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <SDL.h>
 
@@ -23,6 +23,8 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 #include "explosions.h"
 #include "game.h"
 #include "gfx.h"
+#include "grid.h"
+#include "handles.h"
 #include "player.h"
 #include "rng.h"
 #include "smocc.h"
@@ -47,6 +49,7 @@ const double _SLOW_ENEMIES_BUFF_FACTOR = 0.2;
 const double _PUSH_ENEMIES_BUFF_FACTOR = 0.2;
 const double _PUSH_ENEMIES_EFFECT_AT_MIN_HEALTH = 1.5;
 const double _PUSH_ENEMIES_EFFECT_AT_MAX_HEALTH = 0.5;
+const double _BULLETS_GRID_CELL_SIZE_PIXELS = 50.0;
 
 SDL_Color _ENEMY_COLOR = SMOCC_FOREGROUND_COLOR;
 
@@ -54,9 +57,20 @@ int _maxEnemies;
 unsigned long long _spawnRollsDone;
 bool _resetDone;
 
-unsigned long long _nextID;
-
-unordered_map<unsigned long long, Enemy> _enemies;
+// Live enemies, densely packed. Enemy IDs are handles resolving to indices of
+// this vector, so enemies can be swap-removed in place.
+vector<Enemy> _enemies;
+handles::Table _enemyHandles;
+
+// Bullets as of the start of the enemies update, bucketed by tip position so
+// each enemy only checks the bullets in the cells it overlaps. Since bullets
+// are checked along the whole path travelled since the previous update, the
+// longest path is kept to widen the cells checked.
+vector<bullets::Bullet> _bullets;
+vector<double> _bulletTipsX;
+vector<double> _bulletTipsY;
+grid::Grid _bulletsGrid;
+double _maxBulletPathLength;
 
 enum SpawningEdge
 {
@@ -72,7 +86,8 @@ void _initEnemyPosition(Enemy&, SpawningEdge);
 void _initEnemySpeed(Enemy&);
 void _initEnemyRotation(Enemy&, SpawningEdge);
 void _initEnemyHealth(Enemy&);
-void _destroyEnemy(Enemy&);
+void _destroyEnemy(unsigned int index);
+void _removeEnemy(unsigned int index);
 void _rollEnemySpawn();
 void _reset();
 unsigned long long _getSpawnRollsToDo();
@@ -83,7 +98,9 @@ void _updateEnemyPosition(Enemy&);
 void _checkPlayerCollision(Enemy&);
 void _checkScreenEdgesCollision(Enemy&);
 void _checkEnemyEnemyCollision(Enemy&, const Enemy&);
-void _checkBulletCollision(Enemy&, const bullets::Bullet&);
+void _bucketBullets();
+void _checkBulletsCollision(Enemy&);
+void _checkBulletCollision(Enemy&, bullets::Bullet&);
 void _pushEnemy(Enemy&, double, double);
 
 void init()
@@ -104,41 +121,72 @@ void update()
 
     _doNecessarySpawnRolls();
 
-    vector<Enemy> toRemove;
+    unsigned int i = 0;
 
-    for (auto& [_, enemy] : _enemies)
-        if (enemy.health <= 0) toRemove.push_back(enemy);
+    while (i < _enemies.size())
+    {
+        // Destroying swaps the last enemy into this index, so `i` stays.
+        if (_enemies[i].health <= 0)
+            _destroyEnemy(i);
+        else
+            i++;
+    }
 
-    for (Enemy& enemy : toRemove)
-        _destroyEnemy(enemy);
+    _bucketBullets();
 
-    for (auto& [_, enemy] : _enemies)
+    for (Enemy& enemy : _enemies)
     {
         _updateEnemy(enemy);
 
         // Terminate if enemy caused the game to end.
         if (!game::isRunning()) return;
     }
+}
+
+void render()
+{
+    if (!game::isRunning()) return;
+
+    double t = game::getInterpolation();
 
     gfx::setDrawBlendMode(SDL_BLENDMODE_BLEND);
     gfx::setDrawColor(&_ENEMY_COLOR);
 
-    for (auto& [_, enemy] : _enemies)
-        gfx::fillCircle(enemy.x, enemy.y, enemy.radius);
+    for (Enemy& enemy : _enemies)
+    {
+        double x = lerp(enemy.previousX, enemy.x, t);
+        double y = lerp(enemy.previousY, enemy.y, t);
+        double radius = lerp(enemy.previousRadius, enemy.radius, t);
+
+        gfx::fillCircle(x, y, radius);
+    }
 }
 
-void forEach(function<void(const Enemy& enemy)> callback)
+void spawn()
 {
-    for (auto& [_, enemy] : _enemies)
-        callback(enemy);
+    _spawnEnemy();
+}
+
+span<const Enemy> all()
+{
+    return _enemies;
+}
+
+const Enemy* get(unsigned long long id)
+{
+    unsigned int index;
+
+    if (!handles::resolve(_enemyHandles, id, &index)) return nullptr;
+
+    return &_enemies[index];
 }
 
 void _reset()
 {
     _enemies.clear();
+    handles::clear(_enemyHandles);
     _maxEnemies = 0;
     _spawnRollsDone = 0;
-    _nextID = 0;
 
     _resetDone = true;
 }
@@ -167,7 +215,7 @@ void _rollEnemySpawn()
     if (enemiesCount >= _MIN_ENEMY_COUNT && enemiesCount < _maxEnemies)
     {
         double spawnChance = game::getDifficulty();
-        double roll = rng::roll();
+        double roll = rng::roll(rng::ENEMIES);
 
         if (roll < spawnChance) _spawnEnemy();
     }
@@ -179,7 +227,7 @@ void _spawnEnemy()
 {
     Enemy enemy;
 
-    enemy.id = _nextID++;
+    enemy.id = handles::acquire(_enemyHandles, _enemies.size());
     enemy.radius = 0;
 
     SpawningEdge spawningEdge = _rollSpawningEdge();
@@ -188,12 +236,16 @@ void _spawnEnemy()
     _initEnemySpeed(enemy);
     _initEnemyRotation(enemy, spawningEdge);
 
-    _enemies[enemy.id] = enemy;
+    enemy.previousX = enemy.x;
+    enemy.previousY = enemy.y;
+    enemy.previousRadius = enemy.radius;
+
+    _enemies.push_back(enemy);
 }
 
 SpawningEdge _rollSpawningEdge()
 {
-    double roll = rng::rollInt(0, 3);
+    double roll = rng::rollInt(rng::ENEMIES, 0, 3);
 
     if (roll == 0) return LEFT;
     if (roll == 1) return RIGHT;
@@ -203,48 +255,48 @@ SpawningEdge _rollSpawningEdge()
 
 void _initEnemyPosition(Enemy& enemy, SpawningEdge spawningEdge)
 {
-    double locationRoll = rng::roll();
+    double locationRoll = rng::roll(rng::ENEMIES);
 
-    SDL_Window* window = smocc::getWindow();
-    int windowWidth, windowHeight;
+    int worldWidth, worldHeight;
 
-    SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+    smocc::getWorldSize(&worldWidth, &worldHeight);
 
     if (spawningEdge == LEFT)
     {
         enemy.x = 0;
-        enemy.y = locationRoll * windowHeight;
+        enemy.y = locationRoll * worldHeight;
     }
 
     if (spawningEdge == RIGHT)
     {
-        enemy.x = windowWidth;
-        enemy.y = locationRoll * windowHeight;
+        enemy.x = worldWidth;
+        enemy.y = locationRoll * worldHeight;
     }
 
     if (spawningEdge == TOP)
     {
-        enemy.x = locationRoll * windowWidth;
+        enemy.x = locationRoll * worldWidth;
         enemy.y = 0;
     }
 
     if (spawningEdge == BOTTOM)
     {
-        enemy.x = locationRoll * windowWidth;
-        enemy.y = windowHeight;
+        enemy.x = locationRoll * worldWidth;
+        enemy.y = worldHeight;
     }
 }
 
 void _initEnemySpeed(Enemy& enemy)
 {
-    double speed = lerp(MIN_ENEMY_SPEED, MAX_ENEMY_SPEED, rng::roll());
+    double roll = rng::roll(rng::ENEMIES);
+    double speed = lerp(MIN_ENEMY_SPEED, MAX_ENEMY_SPEED, roll);
     enemy.initialSpeed = speed;
     enemy.speed = speed;
 }
 
 void _initEnemyRotation(Enemy& enemy, SpawningEdge spawningEdge)
 {
-    double rotationRadians = M_PI * rng::roll();
+    double rotationRadians = M_PI * rng::roll(rng::ENEMIES);
 
     if (spawningEdge == LEFT) rotationRadians -= M_PI / 2;
     if (spawningEdge == RIGHT) rotationRadians += M_PI / 2;
@@ -259,12 +311,15 @@ void _initEnemyHealth(Enemy& enemy)
     double min = MIN_ENEMY_HEALTH;
     double max = MAX_ENEMY_HEALTH;
     double difficulty = game::getDifficulty();
+    double roll = rng::roll(rng::ENEMIES);
 
-    enemy.health = round(lerp(min, max, rng::roll() * difficulty));
+    enemy.health = round(lerp(min, max, roll * difficulty));
 }
 
-void _destroyEnemy(Enemy& enemy)
+void _destroyEnemy(unsigned int index)
 {
+    Enemy enemy = _enemies[index];
+
     double buffXSpeed = enemy.xSpeed * _DROPPED_BUFF_RELATIVE_SPEED;
     double buffYSpeed = enemy.ySpeed * _DROPPED_BUFF_RELATIVE_SPEED;
 
@@ -276,13 +331,32 @@ void _destroyEnemy(Enemy& enemy)
         buffYSpeed *= -1;
     }
 
-    _enemies.erase(enemy.id);
+    _removeEnemy(index);
     buffs::rollSpawn(enemy.x, enemy.y, buffXSpeed, buffYSpeed);
     game::incrementScore();
 }
 
+void _removeEnemy(unsigned int index)
+{
+    unsigned int last = _enemies.size() - 1;
+
+    handles::release(_enemyHandles, _enemies[index].id);
+
+    if (index != last)
+    {
+        handles::relocate(_enemyHandles, _enemies[last].id, index);
+        _enemies[index] = _enemies[last];
+    }
+
+    _enemies.pop_back();
+}
+
 void _updateEnemy(Enemy& enemy)
 {
+    enemy.previousX = enemy.x;
+    enemy.previousY = enemy.y;
+    enemy.previousRadius = enemy.radius;
+
     _checkPlayerCollision(enemy);
 
     // Terminate if game ended due to player collision.
@@ -290,11 +364,11 @@ void _updateEnemy(Enemy& enemy)
 
     _checkScreenEdgesCollision(enemy);
 
-    for (auto& [_, otherEnemy] : _enemies)
+    for (const Enemy& otherEnemy : _enemies)
         if (enemy.id != otherEnemy.id)
             _checkEnemyEnemyCollision(enemy, otherEnemy);
 
-    bullets::forEach([&](auto b) { _checkBulletCollision(enemy, b); });
+    _checkBulletsCollision(enemy);
 
     _updateEnemyRadius(enemy);
     _updateEnemyPosition(enemy);
@@ -336,7 +410,7 @@ void _checkPlayerCollision(Enemy& enemy)
 
     bool collision = gfx::circlesOverlap(x, y, r, px, py, pr);
 
-    if (collision)
+    if (collision && !player::isInvulnerable())
     {
         game::end();
         ui::game_over::show();
@@ -387,17 +461,70 @@ void _checkEnemyEnemyCollision(Enemy& enemy, const Enemy& otherEnemy)
     }
 }
 
-void _checkBulletCollision(Enemy& enemy, const bullets::Bullet& bullet)
+void _bucketBullets()
+{
+    _bullets.clear();
+    _bulletTipsX.clear();
+    _bulletTipsY.clear();
+
+    bullets::forEach([](auto& b) { _bullets.push_back(b); });
+
+    _maxBulletPathLength = 0;
+
+    for (const bullets::Bullet& bullet : _bullets)
+    {
+        double x1 = bullet.xPreviousTip;
+        double y1 = bullet.yPreviousTip;
+        double x2 = bullet.xTip;
+        double y2 = bullet.yTip;
+        double pathLength = gfx::distance(x1, y1, x2, y2);
+
+        _maxBulletPathLength = max(_maxBulletPathLength, pathLength);
+        _bulletTipsX.push_back(x2);
+        _bulletTipsY.push_back(y2);
+    }
+
+    int w, h;
+
+    smocc::getWorldSize(&w, &h);
+
+    double cellSize = _BULLETS_GRID_CELL_SIZE_PIXELS;
+
+    grid::build(_bulletsGrid, _bulletTipsX, _bulletTipsY, w, h, cellSize);
+}
+
+void _checkBulletsCollision(Enemy& enemy)
+{
+    double x = enemy.x;
+    double y = enemy.y;
+    double range = enemy.radius + _maxBulletPathLength;
+    int c1, r1, c2, r2;
+
+    grid::cellRange(_bulletsGrid, x, y, range, &c1, &r1, &c2, &r2);
+
+    for (int r = r1; r <= r2; r++)
+        for (int c = c1; c <= c2; c++)
+            for (unsigned int i : grid::cell(_bulletsGrid, c, r))
+                _checkBulletCollision(enemy, _bullets[i]);
+}
+
+void _checkBulletCollision(Enemy& enemy, bullets::Bullet& bullet)
 {
     if (bullet.despawning) return;
 
     double ex = enemy.x;
     double ey = enemy.y;
     double er = enemy.radius;
-    double bx = bullet.xTip;
-    double by = bullet.yTip;
+    double x1 = bullet.xPreviousTip;
+    double y1 = bullet.yPreviousTip;
+    double x2 = bullet.xTip;
+    double y2 = bullet.yTip;
+    double bx, by; // where the bullet hits the enemy
 
-    bool collision = gfx::pointInCircle(bx, by, ex, ey, er);
+    // Checking the path instead of just the tip keeps fast bullets or long
+    // updates from skipping over small enemies.
+    bool collision =
+        gfx::segmentCircleEntry(x1, y1, x2, y2, ex, ey, er, &bx, &by);
 
     if (collision)
     {
@@ -411,6 +538,7 @@ void _checkBulletCollision(Enemy& enemy, const bullets::Bullet& bullet)
 
         explosions::spawn(bx, by);
         bullets::despawn(bullet.id);
+        bullet.despawning = true;
     }
 }
 
@@ -10,7 +10,7 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 
 #pragma once
 
-#include <functional>
+#include <span>
 
 namespace smocc::enemies
 {
@@ -31,10 +31,25 @@ struct Enemy
     double initialSpeed;
     double xSpeed;
     double ySpeed;
+
+    // State as of the previous tick, for rendering in between ticks.
+    double previousX;
+    double previousY;
+    double previousRadius;
 };
 
 void init();
 void update();
-void forEach(std::function<void(const Enemy& enemy)> callback);
+void render();
+
+// Spawns an enemy at a random point of the world edges, as the game does.
+void spawn();
+
+// Returns all live enemies, densely packed. The span and pointers into it are
+// invalidated by the next enemies update.
+std::span<const Enemy> all();
+
+// Returns nullptr if the enemy with given ID was destroyed.
+const Enemy* get(unsigned long long id);
 
 } // namespace smocc::enemies
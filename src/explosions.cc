@@ -8,6 +8,7 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 
 */
 
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -44,6 +45,7 @@ bool _resetDone;
 
 void _reset();
 void _updateExplosion(Explosion& explosion);
+void _renderExplosion(Explosion& explosion, double time);
 
 void init()
 {
@@ -69,6 +71,16 @@ void update()
     _toDespawn.clear();
 }
 
+void render()
+{
+    if (!game::isRunning()) return;
+
+    double time = game::getInterpolatedTimeElapsedMilliseconds();
+
+    for (auto& [id, explosion] : _explosions)
+        _renderExplosion(explosion, time);
+}
+
 void spawn(double x, double y)
 {
     Explosion explosion;
@@ -95,12 +107,13 @@ void _updateExplosion(Explosion& explosion)
     unsigned long long elapsed = currentTime - explosion.spawnTime;
 
     if (elapsed > _EXPLOSION_DURATION_MILLISECONDS)
-    {
         _toDespawn.insert(explosion.id);
-        return;
-    }
+}
 
-    double progress = (double)elapsed / _EXPLOSION_DURATION_MILLISECONDS;
+void _renderExplosion(Explosion& explosion, double time)
+{
+    double elapsed = max(time - explosion.spawnTime, 0.0);
+    double progress = elapsed / _EXPLOSION_DURATION_MILLISECONDS;
     double opacity = _EXPLOSION_INITIAL_OPACITY * (1 - progress);
     double radius = _EXPLOSION_FINAL_RADIUS_PIXELS * progress;
 
@@ -15,6 +15,7 @@ namespace smocc::explosions
 
 void init();
 void update();
+void render();
 void spawn(double x, double y);
 
 }
\ No newline at end of file
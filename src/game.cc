@@ -8,12 +8,14 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 
 */
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
 #include <SDL.h>
 
 #include "game.h"
+#include "input.h"
 #include "player.h"
 
 using namespace std;
@@ -25,32 +27,50 @@ const double _MIN_DIFFICULTY = 0.1;
 const double _MAX_DIFFICULTY = 1.0;
 const int _SCORE_INCREMENT = 100;
 
+// Limits the ticks run in a single frame, so that a long hitch slows the game
+// down instead of making every later frame catch up with more ticks.
+const unsigned int _MAX_TICKS_PER_FRAME = 10;
+
 bool _gameRunning;
 unsigned int _score;
 unsigned int _record;
 double _difficulty;
-unsigned long long _gameStartTimeMilliseconds;
-unsigned long long _lastUpdateTimeMilliseconds;
 unsigned long long _timeElapsedMilliseconds;
+
+// Real time is measured with the performance counter, so that the fraction of
+// a tick left over at each frame is accurate for interpolation.
+unsigned long long _lastUpdateCounter;
+unsigned long long _accumulatedCounts;
+unsigned int _tickMilliseconds;
+unsigned int _ticksToDo;
 unsigned int _deltaTime;
 
+void _updateDifficulty();
+unsigned long long _tickCounts();
+
 void init()
 {
     _gameRunning = false;
     _record = 0;
+
+    setTickRate(DEFAULT_TICK_RATE);
 }
 
 void begin()
 {
     cout << "Game start!" << endl;
     _gameRunning = true;
-    _gameStartTimeMilliseconds = SDL_GetTicks64();
-    _lastUpdateTimeMilliseconds = _gameStartTimeMilliseconds;
+    _lastUpdateCounter = SDL_GetPerformanceCounter();
     _timeElapsedMilliseconds = 0;
+    _accumulatedCounts = 0;
+    _ticksToDo = 0;
     _deltaTime = 0;
 
     _score = 0;
 
+    _updateDifficulty();
+
+    input::begin();
     player::spawn();
 }
 
@@ -60,15 +80,41 @@ void update()
 
     if (_score > _record) _record = _score;
 
-    unsigned long long currentTime = SDL_GetTicks64();
+    unsigned long long counter = SDL_GetPerformanceCounter();
+    unsigned long long tickCounts = _tickCounts();
 
-    _deltaTime = currentTime - _lastUpdateTimeMilliseconds;
-    _lastUpdateTimeMilliseconds = currentTime;
-    _timeElapsedMilliseconds = currentTime - _gameStartTimeMilliseconds;
+    _accumulatedCounts += counter - _lastUpdateCounter;
+    _lastUpdateCounter = counter;
 
-    double difficultyFactor = 1.0 - (1.0 / (1.0 + (double)_score / 3000.0));
+    _ticksToDo = _accumulatedCounts / tickCounts;
+    _accumulatedCounts %= tickCounts;
 
-    _difficulty = lerp(_MIN_DIFFICULTY, _MAX_DIFFICULTY, difficultyFactor);
+    if (_ticksToDo > _MAX_TICKS_PER_FRAME)
+    {
+        _ticksToDo = _MAX_TICKS_PER_FRAME;
+        _accumulatedCounts = 0;
+    }
+}
+
+bool tick()
+{
+    if (!_gameRunning) return false;
+    if (_ticksToDo == 0) return false;
+
+    _ticksToDo--;
+    _deltaTime = _tickMilliseconds;
+    _timeElapsedMilliseconds += _tickMilliseconds;
+
+    _updateDifficulty();
+
+    return true;
+}
+
+void scheduleTicks(unsigned int ticks)
+{
+    if (!_gameRunning) return;
+
+    _ticksToDo += ticks;
 }
 
 void end()
@@ -111,4 +157,47 @@ unsigned int getDeltaTimeMilliseconds()
     return _deltaTime;
 }
 
+void setTickRate(unsigned int ticksPerSecond)
+{
+    double milliseconds = round(1000.0 / max(ticksPerSecond, 1u));
+
+    setTickMilliseconds(max(milliseconds, 1.0));
+}
+
+void setTickMilliseconds(unsigned int milliseconds)
+{
+    _tickMilliseconds = max(milliseconds, 1u);
+}
+
+unsigned int getTickMilliseconds()
+{
+    return _tickMilliseconds;
+}
+
+double getInterpolation()
+{
+    return (double)_accumulatedCounts / _tickCounts();
+}
+
+double getInterpolatedTimeElapsedMilliseconds()
+{
+    double t = _timeElapsedMilliseconds;
+
+    t -= (1.0 - getInterpolation()) * _tickMilliseconds;
+
+    return max(t, 0.0);
+}
+
+void _updateDifficulty()
+{
+    double difficultyFactor = 1.0 - (1.0 / (1.0 + (double)_score / 3000.0));
+
+    _difficulty = lerp(_MIN_DIFFICULTY, _MAX_DIFFICULTY, difficultyFactor);
+}
+
+unsigned long long _tickCounts()
+{
+    return SDL_GetPerformanceFrequency() * _tickMilliseconds / 1000;
+}
+
 } // namespace smocc::game
@@ -13,9 +13,23 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 namespace smocc::game
 {
 
+const unsigned int DEFAULT_TICK_RATE = 125;
+
 void init();
 void begin();
+
+// Advances the game clock to the current time, scheduling the simulation ticks
+// due since the previous update.
 void update();
+
+// Starts the next scheduled simulation tick. Returns false when there are none
+// left for this frame, or when no game is running.
+bool tick();
+
+// Schedules ticks to run regardless of the time actually elapsed, for driving
+// the simulation without a real-time clock.
+void scheduleTicks(unsigned int ticks);
+
 void end();
 bool isRunning();
 unsigned int getScore();
@@ -25,4 +39,19 @@ double getDifficulty();
 unsigned long long getTimeElapsedMilliseconds();
 unsigned int getDeltaTimeMilliseconds();
 
+// Sets how many simulation ticks happen every second. Each tick lasts a whole
+// number of milliseconds, so the rate is rounded accordingly.
+void setTickRate(unsigned int ticksPerSecond);
+
+void setTickMilliseconds(unsigned int milliseconds);
+unsigned int getTickMilliseconds();
+
+// Returns how far the current time is between the previous and the latest
+// tick, from 0 to 1, so that rendering can interpolate between the two states.
+double getInterpolation();
+
+// Returns the time elapsed at the point between the previous and the latest
+// tick given by the interpolation factor.
+double getInterpolatedTimeElapsedMilliseconds();
+
 } // namespace smocc::game
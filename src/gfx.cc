@@ -48,10 +48,12 @@ Richard Russell -- richard at rtrussell dot co dot uk
 #include <cassert>
 #include <iostream>
 #include <limits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "gfx.h"
+#include "raster.h"
 #include "smocc.h"
 
 using namespace std;
@@ -61,6 +63,65 @@ namespace fs = std::filesystem;
 namespace smocc::gfx
 {
 
+// Circle sprites are rasterized at radii rounded to a quarter of pixel for
+// small circles, where the rounding would show, and to a whole pixel otherwise.
+const double _SMALL_CIRCLE_RADIUS_STEP = 0.25;
+const double _LARGE_CIRCLE_RADIUS_STEP = 1.0;
+const double _LARGE_CIRCLE_MIN_RADIUS = 16.0;
+
+// The atlas holds a white square, for the untextured primitives, and all the
+// circle sprites up to a maximum radius, so that all of them draw from the
+// same texture and batch together. Sprites are one pixel apart, so that linear
+// filtering doesn't bleed one into another.
+const int _ATLAS_SIZE_PIXELS = 1024;
+const int _ATLAS_WHITE_SIZE_PIXELS = 4;
+const double _ATLAS_MAX_CIRCLE_RADIUS = 80.0;
+
+struct CircleSprite
+{
+    SDL_Texture* texture;
+    int size;
+    SDL_FRect texCoords;
+};
+
+SDL_Texture* _atlas = nullptr;
+SDL_FPoint _atlasWhiteTexCoords;
+
+// Circle sprites, by quantized radius in multiples of the small step. Sprites
+// too large for the atlas have their own texture.
+unordered_map<int, CircleSprite> _circleSprites;
+
+// Primitives are accumulated into a batch as long as they use the same texture
+// and blend mode, and then submitted with a single `SDL_RenderGeometry`.
+vector<SDL_Vertex> _batchVertices;
+vector<int> _batchIndices;
+SDL_Texture* _batchTexture = nullptr;
+SDL_BlendMode _batchBlendMode = SDL_BLENDMODE_NONE;
+
+// The draw color and blend mode are kept here rather than in the renderer, as
+// they are read for every primitive, and the rasterizer works without one.
+SDL_Color _drawColor = {0, 0, 0, 255};
+SDL_BlendMode _drawBlendMode = SDL_BLENDMODE_NONE;
+
+// Scratch storage for `fillPolygon`, kept across calls to avoid allocating for
+// every polygon. The vertex list holds up to this many points.
+const int _POLYGON_LIST_SIZE = 8192;
+
+vector<SDL_FPoint> _polygonList(_POLYGON_LIST_SIZE);
+vector<float> _polygonStrip;
+
+double _quantizeCircleRadius(double radius);
+int _circleSpriteKey(double quantizedRadius);
+int _circleSpriteSize(double quantizedRadius);
+CircleSprite _getCircleSprite(double quantizedRadius);
+void _rasterizeCircle(double quantizedRadius, Uint32* pixels, int pitch);
+SDL_Texture* _getAtlas();
+void _batch(SDL_Texture* texture, SDL_BlendMode blendMode);
+void _pushQuad(const SDL_FPoint* positions, SDL_FRect texCoords, SDL_Color c);
+void _pushRect(float x, float y, float w, float h);
+void _resolveRaster();
+void _submit();
+
 SDL_Cursor* systemCursor(SDL_SystemCursor cursor)
 {
     SDL_Cursor* newCursor = SDL_CreateSystemCursor(cursor);
@@ -115,6 +176,9 @@ double distancePointToSegment(
     auto ac = sub(c, a);
     auto ab = sub(b, a);
 
+    // The projection is undefined for a segment collapsed into a point.
+    if (dot(ab, ab) == 0) return distance(x, y, x1, y1);
+
     auto d = add(a, proj(ac, ab));
     auto ad = sub(d, a);
 
@@ -191,20 +255,18 @@ bool pointInRect(double x, double y, double rx, double ry, double rw, double rh)
 
 bool pointOnScreen(double x, double y)
 {
-    SDL_Window* window = smocc::getWindow();
     int w, h;
 
-    SDL_GetWindowSize(window, &w, &h);
+    smocc::getWorldSize(&w, &h);
 
     return pointInRect(x, y, 0, 0, w, h);
 }
 
 bool rectOnScreen(double x, double y, double w, double h)
 {
-    SDL_Window* window = smocc::getWindow();
     int ww, wh;
 
-    SDL_GetWindowSize(window, &ww, &wh);
+    smocc::getWorldSize(&ww, &wh);
 
     return rectsOverlap(x, y, w, h, 0, 0, ww, wh);
 }
@@ -253,6 +315,41 @@ bool segmentIntersectsCircle(
     return distancePointToSegment(cx, cy, x1, y1, x2, y2) < r;
 }
 
+// Finds the first point of the segment, going from (x1, y1) to (x2, y2), that
+// is within the circle. Returns false if the segment doesn't intersect it.
+bool segmentCircleEntry(
+    double x1, double y1, double x2, double y2, double cx, double cy, double r,
+    double* entryX, double* entryY
+)
+{
+    if (!segmentIntersectsCircle(x1, y1, x2, y2, cx, cy, r)) return false;
+
+    if (pointInCircle(x1, y1, cx, cy, r))
+    {
+        *entryX = x1;
+        *entryY = y1;
+        return true;
+    }
+
+    // Solves |(x1, y1) + t * (dx, dy) - (cx, cy)| = r for the smaller t.
+
+    double dx = x2 - x1;
+    double dy = y2 - y1;
+    double fx = x1 - cx;
+    double fy = y1 - cy;
+
+    double a = dx * dx + dy * dy;
+    double b = 2 * (fx * dx + fy * dy);
+    double c = fx * fx + fy * fy - r * r;
+    double disc = max(0.0, b * b - 4 * a * c);
+    double t = clamp((-b - sqrt(disc)) / (2 * a), 0.0, 1.0);
+
+    *entryX = x1 + t * dx;
+    *entryY = y1 + t * dy;
+
+    return true;
+}
+
 void unit(double x, double y, double* unitX, double* unitY)
 {
     double m = magnitude(x, y);
@@ -426,80 +523,162 @@ void setDrawColor(SDL_Color* c)
 
 void setDrawColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a)
 {
-    SDL_Renderer* renderer = smocc::getRenderer();
-
-    if (SDL_SetRenderDrawColor(renderer, r, g, b, a))
-    {
-        cerr << "Failed to set render draw color: " << SDL_GetError() << endl;
-        exit(1);
-    }
+    _drawColor = {r, g, b, a};
 }
 
 void getDrawColor(Uint8* r, Uint8* g, Uint8* b, Uint8* a)
 {
-    SDL_Renderer* renderer = smocc::getRenderer();
-
-    if (SDL_GetRenderDrawColor(renderer, r, g, b, a))
-    {
-        cerr << "Failed to get render draw color: " << SDL_GetError() << endl;
-        exit(1);
-    }
+    *r = _drawColor.r;
+    *g = _drawColor.g;
+    *b = _drawColor.b;
+    *a = _drawColor.a;
 }
 
 void setDrawBlendMode(SDL_BlendMode blendMode)
 {
-    SDL_Renderer* renderer = smocc::getRenderer();
+    _drawBlendMode = blendMode;
+}
 
-    if (SDL_SetRenderDrawBlendMode(renderer, blendMode))
-    {
-        cerr << "Failed to set render draw blend mode: " << SDL_GetError()
-             << endl;
-        exit(1);
-    }
+SDL_BlendMode premultipliedBlendMode()
+{
+    return SDL_ComposeCustomBlendMode(
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+        SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ONE,
+        SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD
+    );
 }
 
 void fillPixel(int x, int y)
 {
-    SDL_Renderer* renderer = smocc::getRenderer();
-
-    if (SDL_RenderDrawPoint(renderer, x, y))
-    {
-        cerr << "Failed to render pixel: " << SDL_GetError() << endl;
-        exit(1);
-    }
+    _pushRect(x, y, 1, 1);
 }
 
 void drawLine(int x1, int y1, int x2, int y2)
 {
-    SDL_Renderer* renderer = smocc::getRenderer();
+    if (raster::isEnabled())
+    {
+        float ax = x1 + 0.5f;
+        float ay = y1 + 0.5f;
+        float bx = x2 + 0.5f;
+        float by = y2 + 0.5f;
 
-    if (SDL_RenderDrawLine(renderer, x1, y1, x2, y2))
+        raster::drawLine(ax, ay, bx, by, _drawColor, _drawBlendMode);
+        return;
+    }
+
+    float dx = x2 - x1;
+    float dy = y2 - y1;
+    float length = sqrt(dx * dx + dy * dy);
+
+    if (length == 0)
     {
-        cerr << "Failed to render line: " << SDL_GetError() << endl;
-        exit(1);
+        _pushRect(x1, y1, 1, 1);
+        return;
     }
+
+    // A one pixel wide quad through the centers of the end pixels, extended by
+    // half a pixel past them, like the lines drawn by `SDL_RenderDrawLine`.
+    float ux = dx / length / 2;
+    float uy = dy / length / 2;
+    float ax = x1 + 0.5f - ux;
+    float ay = y1 + 0.5f - uy;
+    float bx = x2 + 0.5f + ux;
+    float by = y2 + 0.5f + uy;
+
+    SDL_FPoint positions[] = {
+        {ax - uy, ay + ux},
+        {bx - uy, by + ux},
+        {bx + uy, by - ux},
+        {ax + uy, ay - ux}
+    };
+
+    // The atlas sets the white texel coordinates when it's first made.
+    _batch(_getAtlas(), _drawBlendMode);
+
+    SDL_FPoint white = _atlasWhiteTexCoords;
+    SDL_FRect texCoords = {white.x, white.y, 0, 0};
+
+    _pushQuad(positions, texCoords, _drawColor);
 }
 
 void drawRect(SDL_Rect* rect)
 {
-    SDL_Renderer* renderer = smocc::getRenderer();
+    int x = rect->x;
+    int y = rect->y;
+    int w = rect->w;
+    int h = rect->h;
+
+    if (w <= 0 || h <= 0) return;
+
+    _pushRect(x, y, w, 1);
+
+    if (h == 1) return;
 
-    if (SDL_RenderDrawRect(renderer, rect))
+    _pushRect(x, y + h - 1, w, 1);
+
+    if (h == 2) return;
+
+    _pushRect(x, y + 1, 1, h - 2);
+
+    if (w > 1) _pushRect(x + w - 1, y + 1, 1, h - 2);
+}
+
+void fillRect(SDL_Rect* rect)
+{
+    if (rect != NULL)
     {
-        cerr << "Failed to render rectangle: " << SDL_GetError() << endl;
+        _pushRect(rect->x, rect->y, rect->w, rect->h);
+        return;
+    }
+
+    int w, h;
+
+    if (SDL_GetRendererOutputSize(smocc::getRenderer(), &w, &h))
+    {
+        cerr << "Failed to get renderer output size: " << SDL_GetError()
+             << endl;
         exit(1);
     }
+
+    _pushRect(0, 0, w, h);
 }
 
-void fillRect(SDL_Rect* rect)
+void flush()
+{
+    _resolveRaster();
+    _submit();
+}
+
+void _submit()
 {
+    if (_batchIndices.empty()) return;
+
     SDL_Renderer* renderer = smocc::getRenderer();
 
-    if (SDL_RenderFillRect(renderer, rect))
+    // The atlas is shared by batches with different blend modes.
+    if (_batchTexture == _atlas)
+    {
+        if (SDL_SetTextureBlendMode(_atlas, _batchBlendMode))
+        {
+            cerr << "Failed to set atlas blend mode: " << SDL_GetError()
+                 << endl;
+            exit(1);
+        }
+    }
+
+    int res = SDL_RenderGeometry(
+        renderer, _batchTexture, _batchVertices.data(), _batchVertices.size(),
+        _batchIndices.data(), _batchIndices.size()
+    );
+
+    if (res)
     {
-        cerr << "Failed to fill rectangle: " << SDL_GetError() << endl;
+        cerr << "Failed to render geometry: " << SDL_GetError() << endl;
         exit(1);
     }
+
+    _batchVertices.clear();
+    _batchIndices.clear();
 }
 
 /*
@@ -673,7 +852,26 @@ void fillEllipse(float cx, float cy, float rx, float ry)
 
 void fillCircle(float x, float y, float radius)
 {
-    fillEllipse(x, y, radius, radius);
+    if (radius <= 0) return;
+
+    if (raster::isEnabled())
+    {
+        raster::fillCircle(x, y, radius, _drawColor, _drawBlendMode);
+        return;
+    }
+
+    double quantizedRadius = _quantizeCircleRadius(radius);
+    CircleSprite sprite = _getCircleSprite(quantizedRadius);
+    float size = sprite.size * radius / quantizedRadius;
+    float x1 = x - size / 2;
+    float y1 = y - size / 2;
+    float x2 = x1 + size;
+    float y2 = y1 + size;
+
+    SDL_FPoint positions[] = {{x1, y1}, {x2, y1}, {x2, y2}, {x1, y2}};
+
+    _batch(sprite.texture, _drawBlendMode);
+    _pushQuad(positions, sprite.texCoords, _drawColor);
 }
 
 /*
@@ -699,21 +897,28 @@ void fillPolygon(const double* vx, const double* vy, int n)
     Uint8 r, g, b, a;
     int i, j, xi, yi;
     double x1, x2, y0, y1, y2, minx, maxx, prec;
-    float *list, *strip;
-    const int POLYSIZE = 16384;
+    SDL_FPoint* list;
+    float* strip;
+    const int POLYSIZE = _POLYGON_LIST_SIZE;
 
     getDrawColor(&r, &g, &b, &a);
 
     if (n < 3) return;
 
-    auto compareFloat2 = [](const void* a, const void* b) -> int
+    auto comparePoints = [](const SDL_FPoint& a, const SDL_FPoint& b) -> bool
+    {
+        if (a.y != b.y) return a.y < b.y;
+        return a.x < b.x;
+    };
+
+    auto sortList = [&](int size)
     {
-        float diff = *((float*)a + 1) - *((float*)b + 1);
-        if (diff != 0.0) return (diff > 0) - (diff < 0);
-        diff = *(float*)a - *(float*)b;
-        return (diff > 0) - (diff < 0);
+        sort(_polygonList.begin(), _polygonList.begin() + size, comparePoints);
     };
 
+    // Points are counted by `yi` as they're added to the list.
+    auto push = [&](double x, double y) { list[yi++] = {(float)x, (float)y}; };
+
     // Find extrema:
     minx = 99999.0;
     maxx = -99999.0;
@@ -732,13 +937,8 @@ void fillPolygon(const double* vx, const double* vy, int n)
     maxx = floor(maxx);
     prec = floor(pow(2, 19) / prec);
 
-    // Allocate main array, this determines the maximum polygon size and
-    // complexity:
-    list = (float*)malloc(POLYSIZE * sizeof(float));
-
-    assert(list != NULL);
-
-    if (list == NULL) return;
+    // The main array determines the maximum polygon size and complexity:
+    list = _polygonList.data();
 
     // Build vertex list.  Special x-values used to indicate vertex type:
     // x = -100001.0 indicates /\, x = -100003.0 indicates \/, x = -100002.0
@@ -749,34 +949,26 @@ void fillPolygon(const double* vx, const double* vy, int n)
 
     for (i = 1; i <= n; i++)
     {
-        assert(yi <= POLYSIZE - 4);
+        assert(yi <= POLYSIZE - 2);
 
-        if (yi > POLYSIZE - 4)
-        {
-            free(list);
-            return;
-        }
+        if (yi > POLYSIZE - 2) return;
 
         y2 = floor(vy[i % n] * prec) / prec;
 
         if (((y1 < y2) - (y1 > y2)) == ((y0 < y1) - (y0 > y1)))
         {
-            list[yi++] = -100002.0;
-            list[yi++] = y1;
-            list[yi++] = -100002.0;
-            list[yi++] = y1;
+            push(-100002.0, y1);
+            push(-100002.0, y1);
         }
         else
         {
             if (y0 != y1)
             {
-                list[yi++] = (y1 < y0) - (y1 > y0) - 100002.0;
-                list[yi++] = y1;
+                push((y1 < y0) - (y1 > y0) - 100002.0, y1);
             }
             if (y1 != y2)
             {
-                list[yi++] = (y1 < y2) - (y1 > y2) - 100002.0;
-                list[yi++] = y1;
+                push((y1 < y2) - (y1 > y2) - 100002.0, y1);
             }
         }
         y0 = y1;
@@ -785,7 +977,7 @@ void fillPolygon(const double* vx, const double* vy, int n)
     xi = yi;
 
     // Sort vertex list:
-    qsort(list, yi / 2, sizeof(float) * 2, compareFloat2);
+    sortList(yi);
 
     // Append line list to vertex list:
     for (i = 1; i <= n; i++)
@@ -813,34 +1005,22 @@ void fillPolygon(const double* vx, const double* vy, int n)
 
         if (y2 != y1) y0 = (x2 - x1) / (y2 - y1);
 
-        for (j = 1; j < xi; j += 4)
+        for (j = 0; j < xi; j += 2)
         {
-            y = list[j];
+            y = list[j].y;
 
-            if (((y + d) <= y1) || (y == list[j + 4])) continue;
+            if (((y + d) <= y1) || (y == list[j + 2].y)) continue;
             if ((y -= d) >= y2) break;
 
-            assert(yi <= POLYSIZE - 4);
+            assert(yi <= POLYSIZE - 2);
 
-            if (yi > POLYSIZE - 4)
-            {
-                free(list);
-                return;
-            }
+            if (yi > POLYSIZE - 2) return;
 
-            if (y > y1)
-            {
-                list[yi++] = x1 + y0 * (y - y1);
-                list[yi++] = y;
-            }
+            if (y > y1) push(x1 + y0 * (y - y1), y);
 
             y += d * 2.0;
 
-            if (y < y2)
-            {
-                list[yi++] = x1 + y0 * (y - y1);
-                list[yi++] = y;
-            }
+            if (y < y2) push(x1 + y0 * (y - y1), y);
         }
 
         y = floor(y1) + 1.0;
@@ -849,54 +1029,40 @@ void fillPolygon(const double* vx, const double* vy, int n)
         {
             x = x1 + y0 * (y - y1);
 
-            assert(yi <= POLYSIZE - 2);
+            assert(yi <= POLYSIZE - 1);
 
-            if (yi > POLYSIZE - 2)
-            {
-                free(list);
-                return;
-            }
+            if (yi > POLYSIZE - 1) return;
 
-            list[yi++] = x;
-            list[yi++] = y;
+            push(x, y);
 
             y += 1.0;
         }
     }
 
     // Sort combined list:
-    qsort(list, yi / 2, sizeof(float) * 2, compareFloat2);
+    sortList(yi);
 
     // Plot lines:
-    strip = (float*)malloc((maxx - minx + 2) * sizeof(float));
-
-    assert(strip != NULL);
-
-    if (strip == NULL)
-    {
-        free(list);
-        return;
-    }
-
-    memset(strip, 0, (maxx - minx + 2) * sizeof(float));
+    _polygonStrip.assign(maxx - minx + 2, 0);
+    strip = _polygonStrip.data();
 
     n = yi;
-    yi = list[1];
+    yi = list[0].y;
     j = 0;
 
-    for (i = 0; i < n - 7; i += 4)
+    for (i = 0; i < n - 3; i += 2)
     {
-        float x1 = list[i + 0];
-        float y1 = list[i + 1];
-        float x3 = list[i + 2];
-        float x2 = list[i + j + 0];
-        float y2 = list[i + j + 1];
-        float x4 = list[i + j + 2];
+        float x1 = list[i].x;
+        float y1 = list[i].y;
+        float x3 = list[i + 1].x;
+        float x2 = list[i + j].x;
+        float y2 = list[i + j].y;
+        float x4 = list[i + j + 1].x;
 
         if (x1 + x3 == -200002.0)
-            j += 4;
+            j += 2;
         else if (x1 + x3 == -200006.0)
-            j -= 4;
+            j -= 2;
         else if ((x1 >= minx) && (x2 >= minx))
         {
             if (x1 > x2)
@@ -933,7 +1099,7 @@ void fillPolygon(const double* vx, const double* vy, int n)
             }
         }
 
-        if ((yi == (list[i + 5] - 1.0)) || (i == n - 8))
+        if ((yi == (list[i + 2].y - 1.0)) || (i == n - 4))
         {
             for (xi = 0; xi <= maxx - minx; xi++)
             {
@@ -966,21 +1132,73 @@ void fillPolygon(const double* vx, const double* vy, int n)
     }
 
     setDrawColor(r, g, b, a);
-
-    // Free arrays:
-    free(list);
-    free(strip);
 }
 
 void renderTexture(SDL_Texture* texture, SDL_Rect* rect)
 {
-    SDL_Renderer* renderer = smocc::getRenderer();
+    renderTexture(texture, NULL, rect);
+}
+
+void renderTexture(SDL_Texture* texture, SDL_Rect* source, SDL_Rect* rect)
+{
+    SDL_Rect fullRect;
 
-    if (SDL_RenderCopy(renderer, texture, NULL, rect))
+    if (rect == NULL)
     {
-        cerr << "Failed to render texture: " << SDL_GetError() << endl;
+        fullRect.x = 0;
+        fullRect.y = 0;
+
+        SDL_Renderer* renderer = smocc::getRenderer();
+
+        if (SDL_GetRendererOutputSize(renderer, &fullRect.w, &fullRect.h))
+        {
+            cerr << "Failed to get renderer output size: " << SDL_GetError()
+                 << endl;
+            exit(1);
+        }
+
+        rect = &fullRect;
+    }
+
+    // Geometry is drawn with the vertex color instead of the texture color and
+    // alpha modulation, so the modulation is applied through the vertices.
+    SDL_BlendMode blendMode;
+    SDL_Color c;
+
+    bool failed = SDL_GetTextureBlendMode(texture, &blendMode);
+
+    failed = failed || SDL_GetTextureColorMod(texture, &c.r, &c.g, &c.b);
+    failed = failed || SDL_GetTextureAlphaMod(texture, &c.a);
+
+    if (failed)
+    {
+        cerr << "Failed to query texture modulation: " << SDL_GetError()
+             << endl;
         exit(1);
     }
+
+    float x1 = rect->x;
+    float y1 = rect->y;
+    float x2 = x1 + rect->w;
+    float y2 = y1 + rect->h;
+
+    SDL_FPoint positions[] = {{x1, y1}, {x2, y1}, {x2, y2}, {x1, y2}};
+    SDL_FRect texCoords = {0, 0, 1, 1};
+
+    if (source != NULL)
+    {
+        SDL_Rect size = textureSize(texture);
+
+        texCoords.x = (float)source->x / size.w;
+        texCoords.y = (float)source->y / size.h;
+        texCoords.w = (float)source->w / size.w;
+        texCoords.h = (float)source->h / size.h;
+    }
+
+    // Whatever was rasterized so far goes below the texture.
+    _resolveRaster();
+    _batch(texture, blendMode);
+    _pushQuad(positions, texCoords, c);
 }
 
 void renderTexture(SDL_Texture* texture, int x, int y)
@@ -993,4 +1211,251 @@ void renderTexture(SDL_Texture* texture, int x, int y)
     renderTexture(texture, &rect);
 }
 
+double _quantizeCircleRadius(double radius)
+{
+    bool small = radius < _LARGE_CIRCLE_MIN_RADIUS;
+    double step = small ? _SMALL_CIRCLE_RADIUS_STEP : _LARGE_CIRCLE_RADIUS_STEP;
+
+    return max(round(radius / step) * step, _SMALL_CIRCLE_RADIUS_STEP);
+}
+
+int _circleSpriteKey(double quantizedRadius)
+{
+    return round(quantizedRadius / _SMALL_CIRCLE_RADIUS_STEP);
+}
+
+int _circleSpriteSize(double quantizedRadius)
+{
+    // One pixel of padding on each side, for the anti-aliased edge.
+    return 2 * (int)ceil(quantizedRadius) + 2;
+}
+
+CircleSprite _getCircleSprite(double quantizedRadius)
+{
+    _getAtlas();
+
+    int key = _circleSpriteKey(quantizedRadius);
+
+    if (_circleSprites.contains(key)) return _circleSprites[key];
+
+    CircleSprite sprite;
+    sprite.size = _circleSpriteSize(quantizedRadius);
+    sprite.texCoords = {0, 0, 1, 1};
+    sprite.texture = SDL_CreateTexture(
+        smocc::getRenderer(), SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STATIC, sprite.size, sprite.size
+    );
+
+    if (!sprite.texture)
+    {
+        cerr << "Failed to create circle sprite: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    vector<Uint32> pixels(sprite.size * sprite.size);
+    int pitch = sprite.size * sizeof(Uint32);
+
+    _rasterizeCircle(quantizedRadius, pixels.data(), pitch);
+
+    SDL_Texture* texture = sprite.texture;
+    bool failed = SDL_UpdateTexture(texture, NULL, pixels.data(), pitch);
+
+    failed = failed || SDL_SetTextureScaleMode(texture, SDL_ScaleModeLinear);
+
+    if (failed)
+    {
+        cerr << "Failed to rasterize circle sprite: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    _circleSprites[key] = sprite;
+
+    return sprite;
+}
+
+void _rasterizeCircle(double quantizedRadius, Uint32* pixels, int pitch)
+{
+    // White pixels, with the coverage of each pixel by the circle as alpha. The
+    // coverage is approximated by the distance of the pixel center from the
+    // circle edge, which is accurate enough for a one pixel wide edge.
+    int size = _circleSpriteSize(quantizedRadius);
+    double center = size / 2.0;
+
+    for (int py = 0; py < size; py++)
+    {
+        Uint32* row = pixels + py * pitch / sizeof(Uint32);
+
+        for (int px = 0; px < size; px++)
+        {
+            double d = distance(px + 0.5, py + 0.5, center, center);
+            double coverage = clamp(quantizedRadius + 0.5 - d, 0.0, 1.0);
+            Uint32 alpha = round(coverage * 255);
+
+            row[px] = alpha << 24 | 0xFFFFFF;
+        }
+    }
+}
+
+SDL_Texture* _getAtlas()
+{
+    if (_atlas) return _atlas;
+
+    _atlas = SDL_CreateTexture(
+        smocc::getRenderer(), SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STATIC, _ATLAS_SIZE_PIXELS, _ATLAS_SIZE_PIXELS
+    );
+
+    if (!_atlas)
+    {
+        cerr << "Failed to create atlas: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    const int n = _ATLAS_SIZE_PIXELS;
+    const float texel = 1.0f / n;
+    const int pitch = n * sizeof(Uint32);
+
+    vector<Uint32> pixels(n * n, 0);
+
+    for (int y = 0; y < _ATLAS_WHITE_SIZE_PIXELS; y++)
+        for (int x = 0; x < _ATLAS_WHITE_SIZE_PIXELS; x++)
+            pixels[y * n + x] = 0xFFFFFFFF;
+
+    _atlasWhiteTexCoords.x = _ATLAS_WHITE_SIZE_PIXELS / 2.0f * texel;
+    _atlasWhiteTexCoords.y = _ATLAS_WHITE_SIZE_PIXELS / 2.0f * texel;
+
+    // Packs the sprites into shelves, from the largest, which leaves little
+    // room unused. The white square starts the first shelf.
+    int x = _ATLAS_WHITE_SIZE_PIXELS + 1;
+    int y = 0;
+    int shelfHeight = _ATLAS_WHITE_SIZE_PIXELS;
+    double radius = _ATLAS_MAX_CIRCLE_RADIUS;
+
+    while (radius >= _SMALL_CIRCLE_RADIUS_STEP)
+    {
+        int size = _circleSpriteSize(radius);
+
+        if (x + size > n)
+        {
+            x = 0;
+            y += shelfHeight + 1;
+            shelfHeight = 0;
+        }
+
+        assert(y + size <= n);
+
+        _rasterizeCircle(radius, &pixels[y * n + x], pitch);
+
+        CircleSprite sprite;
+        sprite.texture = _atlas;
+        sprite.size = size;
+        sprite.texCoords = {x * texel, y * texel, size * texel, size * texel};
+
+        _circleSprites[_circleSpriteKey(radius)] = sprite;
+
+        x += size + 1;
+        shelfHeight = max(shelfHeight, size);
+
+        bool small = radius <= _LARGE_CIRCLE_MIN_RADIUS;
+
+        radius -= small ? _SMALL_CIRCLE_RADIUS_STEP : _LARGE_CIRCLE_RADIUS_STEP;
+    }
+
+    bool failed = SDL_UpdateTexture(_atlas, NULL, pixels.data(), pitch);
+
+    failed = failed || SDL_SetTextureScaleMode(_atlas, SDL_ScaleModeLinear);
+
+    if (failed)
+    {
+        cerr << "Failed to fill atlas: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    return _atlas;
+}
+
+void _batch(SDL_Texture* texture, SDL_BlendMode blendMode)
+{
+    if (texture == _batchTexture && blendMode == _batchBlendMode) return;
+
+    _submit();
+
+    _batchTexture = texture;
+    _batchBlendMode = blendMode;
+}
+
+void _pushQuad(const SDL_FPoint* positions, SDL_FRect texCoords, SDL_Color c)
+{
+    int first = _batchVertices.size();
+
+    float u1 = texCoords.x;
+    float v1 = texCoords.y;
+    float u2 = texCoords.x + texCoords.w;
+    float v2 = texCoords.y + texCoords.h;
+
+    _batchVertices.push_back({positions[0], c, {u1, v1}});
+    _batchVertices.push_back({positions[1], c, {u2, v1}});
+    _batchVertices.push_back({positions[2], c, {u2, v2}});
+    _batchVertices.push_back({positions[3], c, {u1, v2}});
+
+    _batchIndices.push_back(first);
+    _batchIndices.push_back(first + 1);
+    _batchIndices.push_back(first + 2);
+    _batchIndices.push_back(first);
+    _batchIndices.push_back(first + 2);
+    _batchIndices.push_back(first + 3);
+}
+
+void _pushRect(float x, float y, float w, float h)
+{
+    if (raster::isEnabled())
+    {
+        raster::fillRect(x, y, w, h, _drawColor, _drawBlendMode);
+        return;
+    }
+
+    SDL_FPoint positions[] = {{x, y}, {x + w, y}, {x + w, y + h}, {x, y + h}};
+
+    // The atlas sets the white texel coordinates when it's first made.
+    _batch(_getAtlas(), _drawBlendMode);
+
+    SDL_FPoint white = _atlasWhiteTexCoords;
+    SDL_FRect texCoords = {white.x, white.y, 0, 0};
+
+    _pushQuad(positions, texCoords, _drawColor);
+}
+
+void _resolveRaster()
+{
+    if (!raster::isEnabled() || !raster::isDirty()) return;
+
+    SDL_Rect rect;
+    SDL_Texture* texture = raster::upload(&rect);
+
+    float x1 = rect.x;
+    float y1 = rect.y;
+    float x2 = x1 + rect.w;
+    float y2 = y1 + rect.h;
+
+    SDL_FPoint positions[] = {{x1, y1}, {x2, y1}, {x2, y2}, {x1, y2}};
+
+    float w = raster::getWidth();
+    float h = raster::getHeight();
+    SDL_FRect texCoords = {x1 / w, y1 / h, rect.w / w, rect.h / h};
+
+    SDL_BlendMode blendMode;
+
+    if (SDL_GetTextureBlendMode(texture, &blendMode))
+    {
+        cerr << "Failed to get framebuffer blend mode: " << SDL_GetError()
+             << endl;
+        exit(1);
+    }
+
+    // The texture is uploaded again for the next resolve, so it's drawn now.
+    _batch(texture, blendMode);
+    _pushQuad(positions, texCoords, {255, 255, 255, 255});
+    _submit();
+}
+
 } // namespace smocc::gfx
\ No newline at end of file
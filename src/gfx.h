@@ -46,6 +46,10 @@ bool pointInCircle(double x, double y, double cx, double cy, double r);
 bool segmentIntersectsCircle(
     double x1, double y1, double x2, double y2, double cx, double cy, double r
 );
+bool segmentCircleEntry(
+    double x1, double y1, double x2, double y2, double cx, double cy, double r,
+    double* entryX, double* entryY
+);
 void unit(double x, double y, double* unitX, double* unitY);
 void direction(
     double originX, double originY, double targetX, double targetY,
@@ -79,14 +83,31 @@ void setDrawColor(SDL_Color* color);
 void setDrawColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a);
 void getDrawColor(Uint8* r, Uint8* g, Uint8* b, Uint8* a);
 void setDrawBlendMode(SDL_BlendMode blendMode);
+
+// Returns the blend mode for drawing textures with premultiplied alpha, like
+// those that were drawn into with alpha blending starting from transparent.
+SDL_BlendMode premultipliedBlendMode();
+
+// The drawing functions below don't draw right away: they accumulate geometry
+// into a batch, which is submitted when the texture or blend mode changes, or
+// when `flush` is called. Flush before presenting or switching render target.
 void fillPixel(int x, int y);
 void drawLine(int x1, int y1, int x2, int y2);
 void drawRect(SDL_Rect* rect);
 void fillRect(SDL_Rect* rect);
 void fillEllipse(float cx, float cy, float rx, float ry);
+
+// Fills an anti-aliased circle with the draw color and blend mode, as a single
+// textured quad. The texture is taken from an atlas of circles rasterized ahead
+// at quantized radii, and scaled to the exact radius.
 void fillCircle(float x, float y, float radius);
+
 void fillPolygon(const double* vx, const double* vy, int n);
 void renderTexture(SDL_Texture* texture, SDL_Rect* rect);
+void renderTexture(SDL_Texture* texture, SDL_Rect* source, SDL_Rect* rect);
 void renderTexture(SDL_Texture* texture, int x, int y);
 
+// Submits the accumulated geometry to the renderer.
+void flush();
+
 } // namespace smocc::gfx
\ No newline at end of file
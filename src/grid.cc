@@ -0,0 +1,102 @@
+/*
+
+grid.cc: Uniform grid for spatial queries in SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "grid.h"
+
+using namespace std;
+
+namespace smocc::grid
+{
+
+int _column(const Grid& grid, double x);
+int _row(const Grid& grid, double y);
+
+void build(
+    Grid& grid, span<const double> xs, span<const double> ys, double width,
+    double height, double cellSize
+)
+{
+    assert(xs.size() == ys.size());
+    assert(cellSize > 0);
+
+    unsigned int n = xs.size();
+
+    grid.cellSize = cellSize;
+    grid.columns = max(1, (int)ceil(width / cellSize));
+    grid.rows = max(1, (int)ceil(height / cellSize));
+
+    unsigned int cells = grid.columns * grid.rows;
+
+    // Counting sort of the points by cell: count, prefix sum, then scatter.
+
+    grid.cellStarts.assign(cells + 1, 0);
+    grid.itemCells.resize(n);
+    grid.items.resize(n);
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        int c = _column(grid, xs[i]);
+        int r = _row(grid, ys[i]);
+        unsigned int cell = r * grid.columns + c;
+
+        grid.itemCells[i] = cell;
+        grid.cellStarts[cell + 1]++;
+    }
+
+    for (unsigned int c = 0; c < cells; c++)
+        grid.cellStarts[c + 1] += grid.cellStarts[c];
+
+    // Uses the cell starts as cursors while scattering, which leaves each one
+    // at the start of the following cell, then shifts them back in place.
+
+    for (unsigned int i = 0; i < n; i++)
+        grid.items[grid.cellStarts[grid.itemCells[i]]++] = i;
+
+    for (unsigned int c = cells; c > 0; c--)
+        grid.cellStarts[c] = grid.cellStarts[c - 1];
+
+    grid.cellStarts[0] = 0;
+}
+
+void cellRange(
+    const Grid& grid, double x, double y, double halfSide, int* c1, int* r1,
+    int* c2, int* r2
+)
+{
+    *c1 = _column(grid, x - halfSide);
+    *r1 = _row(grid, y - halfSide);
+    *c2 = _column(grid, x + halfSide);
+    *r2 = _row(grid, y + halfSide);
+}
+
+span<const unsigned int> cell(const Grid& grid, int column, int row)
+{
+    unsigned int c = row * grid.columns + column;
+    unsigned int start = grid.cellStarts[c];
+    unsigned int end = grid.cellStarts[c + 1];
+
+    return span<const unsigned int>(grid.items).subspan(start, end - start);
+}
+
+int _column(const Grid& grid, double x)
+{
+    return clamp((int)floor(x / grid.cellSize), 0, grid.columns - 1);
+}
+
+int _row(const Grid& grid, double y)
+{
+    return clamp((int)floor(y / grid.cellSize), 0, grid.rows - 1);
+}
+
+} // namespace smocc::grid
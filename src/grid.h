@@ -0,0 +1,52 @@
+/*
+
+grid.h: Uniform grid for spatial queries in SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#pragma once
+
+#include <span>
+#include <vector>
+
+namespace smocc::grid
+{
+
+// Points bucketed into square cells covering a rectangle from (0, 0) to
+// (width, height). Points outside the rectangle go into the nearest edge cell.
+// Item indices of the points in cell `c` are stored contiguously, from
+// `items[cellStarts[c]]` to `items[cellStarts[c + 1]]` excluded.
+struct Grid
+{
+    double cellSize;
+    int columns;
+    int rows;
+
+    std::vector<unsigned int> cellStarts;
+    std::vector<unsigned int> items;
+    std::vector<unsigned int> itemCells;
+};
+
+// Buckets the points, given as parallel coordinate arrays, into the grid. The
+// index of each point in the arrays is used as its item index.
+void build(
+    Grid& grid, std::span<const double> xs, std::span<const double> ys,
+    double width, double height, double cellSize
+);
+
+// Finds the range of cells overlapped by the square of given center and half
+// side length. The range includes the cells from `c1` to `c2` and from `r1` to
+// `r2`.
+void cellRange(
+    const Grid& grid, double x, double y, double halfSide, int* c1, int* r1,
+    int* c2, int* r2
+);
+
+// Returns the item indices of the points in the given cell.
+std::span<const unsigned int> cell(const Grid& grid, int column, int row);
+
+} // namespace smocc::grid
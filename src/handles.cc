@@ -0,0 +1,97 @@
+/*
+
+handles.cc: Generational handles for densely stored entities in SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#include <cassert>
+
+#include "handles.h"
+
+namespace smocc::handles
+{
+
+unsigned int _slot(unsigned long long handle);
+unsigned int _generation(unsigned long long handle);
+
+unsigned long long acquire(Table& table, unsigned int index)
+{
+    unsigned int slot;
+
+    if (table.freeSlots.empty())
+    {
+        slot = table.indices.size();
+        table.indices.push_back(index);
+        table.generations.push_back(0);
+    }
+    else
+    {
+        slot = table.freeSlots.back();
+        table.freeSlots.pop_back();
+        table.indices[slot] = index;
+    }
+
+    unsigned long long generation = table.generations[slot];
+
+    return generation << 32 | slot;
+}
+
+void relocate(Table& table, unsigned long long handle, unsigned int index)
+{
+    assert(resolve(table, handle, nullptr));
+
+    table.indices[_slot(handle)] = index;
+}
+
+void release(Table& table, unsigned long long handle)
+{
+    assert(resolve(table, handle, nullptr));
+
+    unsigned int slot = _slot(handle);
+
+    table.generations[slot]++;
+    table.freeSlots.push_back(slot);
+}
+
+bool resolve(
+    const Table& table, unsigned long long handle, unsigned int* index
+)
+{
+    unsigned int slot = _slot(handle);
+
+    if (slot >= table.generations.size()) return false;
+    if (table.generations[slot] != _generation(handle)) return false;
+
+    if (index != nullptr) *index = table.indices[slot];
+
+    return true;
+}
+
+void clear(Table& table)
+{
+    unsigned int slots = table.generations.size();
+
+    table.freeSlots.clear();
+
+    for (unsigned int slot = slots; slot > 0; slot--)
+    {
+        table.generations[slot - 1]++;
+        table.freeSlots.push_back(slot - 1);
+    }
+}
+
+unsigned int _slot(unsigned long long handle)
+{
+    return handle & 0xFFFFFFFF;
+}
+
+unsigned int _generation(unsigned long long handle)
+{
+    return handle >> 32;
+}
+
+} // namespace smocc::handles
@@ -0,0 +1,46 @@
+/*
+
+handles.h: Generational handles for densely stored entities in SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#pragma once
+
+#include <vector>
+
+namespace smocc::handles
+{
+
+// Maps stable handles to indices into a densely packed array. A handle packs a
+// slot number in its lower 32 bits and the generation of that slot in its
+// upper 32 bits, so the handle of a removed element never resolves again, even
+// after its slot gets reused.
+struct Table
+{
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> generations;
+    std::vector<unsigned int> freeSlots;
+};
+
+// Returns a new handle resolving to the given dense index.
+unsigned long long acquire(Table& table, unsigned int index);
+
+// Makes the handle resolve to a new dense index, e.g. after a swap-remove.
+void relocate(Table& table, unsigned long long handle, unsigned int index);
+
+// Invalidates the handle and frees its slot for reuse.
+void release(Table& table, unsigned long long handle);
+
+// Returns false if the handle was released or never acquired.
+bool resolve(
+    const Table& table, unsigned long long handle, unsigned int* index
+);
+
+// Invalidates all handles, keeping allocated memory around.
+void clear(Table& table);
+
+} // namespace smocc::handles
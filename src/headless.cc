@@ -0,0 +1,240 @@
+/*
+
+headless.cc: Simulation without window, renderer or fonts for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#include <SDL.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "bots.h"
+#include "buffs.h"
+#include "bullets.h"
+#include "enemies.h"
+#include "explosions.h"
+#include "game.h"
+#include "headless.h"
+#include "input.h"
+#include "player.h"
+#include "raster.h"
+#include "rng.h"
+#include "smocc.h"
+#include "workers.h"
+
+using namespace std;
+
+namespace smocc::headless
+{
+
+unsigned int _sessions = 1;
+unsigned long long _maxTicks = DEFAULT_MAX_TICKS;
+bool _render = false;
+const char* _frameDumpPath = nullptr;
+
+void _init(int, char*[]);
+void _parseArguments(int, char*[]);
+unsigned long long _runSession(unsigned int session);
+void _renderFrame();
+void _dumpFrame(const char* path);
+
+int main(int argc, char* argv[])
+{
+    _init(argc, argv);
+
+    // Replays print their own seed.
+    if (!smocc::input::isReplaying())
+        cout << "Seed: " << smocc::rng::getSeed() << endl;
+
+    unsigned long long startTime = SDL_GetTicks64();
+    unsigned long long totalTicks = 0;
+
+    for (unsigned int session = 1; session <= _sessions; session++)
+        totalTicks += _runSession(session);
+
+    unsigned long long elapsed = SDL_GetTicks64() - startTime;
+    double seconds = max(elapsed, 1ull) / 1000.0;
+
+    cout << "Sessions: " << _sessions << endl;
+    cout << "Ticks: " << totalTicks << endl;
+    cout << "Wall time: " << elapsed << " ms" << endl;
+    cout << "Ticks per second: " << (unsigned long long)(totalTicks / seconds);
+    cout << endl;
+
+    return 0;
+}
+
+void _init(int argc, char* argv[])
+{
+    // Only the timer is needed, for measuring the throughput.
+    if (SDL_Init(SDL_INIT_TIMER))
+    {
+        cerr << "Failed to initialize SDL: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    smocc::workers::init();
+    smocc::rng::init();
+    smocc::game::init();
+    smocc::input::init();
+    smocc::player::init();
+    smocc::enemies::init();
+    smocc::bots::init();
+    smocc::bullets::init();
+    smocc::explosions::init();
+    smocc::buffs::init();
+
+    _parseArguments(argc, argv);
+
+    // A replay is of a single game.
+    if (smocc::input::isReplaying()) _sessions = 1;
+
+    if (_render)
+    {
+        int w, h;
+
+        smocc::getWorldSize(&w, &h);
+        smocc::raster::init(w, h);
+    }
+}
+
+void _parseArguments(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (!strcmp(argv[i], "--sessions") && hasValue)
+        {
+            _sessions = atoi(argv[++i]);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--max-ticks") && hasValue)
+        {
+            _maxTicks = strtoull(argv[++i], nullptr, 10);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--replay") && hasValue)
+        {
+            smocc::input::replay(argv[++i]);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--render"))
+        {
+            _render = true;
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--frame-dump") && hasValue)
+        {
+            _render = true;
+            _frameDumpPath = argv[++i];
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--seed") && hasValue)
+        {
+            smocc::rng::seed(strtoull(argv[++i], nullptr, 10));
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--tick-rate") && hasValue)
+        {
+            smocc::game::setTickRate(atoi(argv[++i]));
+            continue;
+        }
+
+        cerr << "Ignoring unknown argument: " << argv[i] << endl;
+    }
+}
+
+unsigned long long _runSession(unsigned int session)
+{
+    unsigned long long ticks = 0;
+
+    smocc::game::begin();
+
+    while (smocc::game::isRunning() && ticks < _maxTicks)
+    {
+        smocc::game::scheduleTicks(1);
+
+        while (smocc::game::tick())
+        {
+            smocc::updateGame();
+            ticks++;
+
+            if (_render) _renderFrame();
+        }
+    }
+
+    unsigned int score = smocc::game::getScore();
+    unsigned long long time = smocc::game::getTimeElapsedMilliseconds();
+
+    smocc::game::end();
+
+    // Game modules reset themselves when updated while no game is running.
+    smocc::updateGame();
+
+    cout << "Session " << session << ": score " << score << ", " << ticks;
+    cout << " ticks, " << time << " ms of game time" << endl;
+
+    if (_render)
+    {
+        cout << "Frame hash: " << hex << smocc::raster::hash() << dec << endl;
+
+        if (_frameDumpPath) _dumpFrame(_frameDumpPath);
+    }
+
+    return ticks;
+}
+
+void _renderFrame()
+{
+    smocc::raster::clear();
+    smocc::renderGame();
+}
+
+// Writes the last frame as a binary PPM image, over a white background like the
+// one the window is cleared with.
+void _dumpFrame(const char* path)
+{
+    ofstream file(path, ios::binary);
+
+    if (!file)
+    {
+        cerr << "Failed to open frame dump file: " << path << endl;
+        exit(1);
+    }
+
+    int w = smocc::raster::getWidth();
+    int h = smocc::raster::getHeight();
+    const Uint32* pixels = smocc::raster::getPixels();
+
+    file << "P6\n" << w << " " << h << "\n255\n";
+
+    for (int i = 0; i < w * h; i++)
+    {
+        Uint32 p = pixels[i];
+        Uint32 transparency = 255 - (p >> 24);
+
+        char rgb[] = {
+            (char)min((p >> 16 & 0xFF) + transparency, 255u),
+            (char)min((p >> 8 & 0xFF) + transparency, 255u),
+            (char)min((p & 0xFF) + transparency, 255u)
+        };
+
+        file.write(rgb, sizeof(rgb));
+    }
+}
+
+} // namespace smocc::headless
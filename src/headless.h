@@ -0,0 +1,23 @@
+/*
+
+headless.h: Simulation without window, renderer or fonts for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#pragma once
+
+namespace smocc::headless
+{
+
+// Default limit of ticks for a session, 10 minutes at the default tick rate.
+const unsigned long long DEFAULT_MAX_TICKS = 75000;
+
+// Entry point of the headless build. Runs game sessions back to back as fast as
+// possible, in a world of the default window size, and prints their results.
+int main(int, char**);
+
+} // namespace smocc::headless
@@ -0,0 +1,313 @@
+/*
+
+input.cc: Game input sampling, recording and replay for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#include <SDL.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "game.h"
+#include "input.h"
+#include "rng.h"
+#include "smocc.h"
+#include "ui/game_over.h"
+
+using namespace std;
+
+namespace smocc::input
+{
+
+// Replay files start with a header made of the magic bytes, the version of
+// the format, the seed of the random number generators (8 bytes) and the
+// length of a tick in milliseconds (2 bytes). Then, each tick takes one byte
+// for its delta time and one for its flags: a bit for each key, and one
+// telling that the mouse moved, in which case its position follows (2 + 2
+// bytes). Numbers are little endian.
+const char _MAGIC[] = {'S', 'M', 'R', 'P'};
+const unsigned char _VERSION = 1;
+const unsigned char _MOUSE_MOVED_FLAG = 1 << 7;
+const unsigned int _KEYS_COUNT = 4;
+
+bool _keys[_KEYS_COUNT];
+int _mouseX;
+int _mouseY;
+unsigned long long _ticks;
+
+bool _recordRequested;
+bool _recording;
+const char* _recordPath;
+ofstream _recordFile;
+int _recordedMouseX;
+int _recordedMouseY;
+
+bool _replayRequested;
+bool _replaying;
+ifstream _replayFile;
+unsigned long long _replaySeed;
+unsigned int _replayTickMilliseconds;
+
+void _sample();
+void _writeTick();
+bool _readTick();
+void _stopReplay(const char* reason);
+void _write(unsigned long long value, int bytes);
+bool _read(int bytes, unsigned long long* value);
+
+void init()
+{
+    memset(_keys, 0, sizeof(_keys));
+
+    // Aims to the right, like a new bullet source, until the mouse is sampled.
+    int w, h;
+
+    smocc::getWorldSize(&w, &h);
+
+    _mouseX = w;
+    _mouseY = h / 2;
+
+    _recordRequested = false;
+    _recording = false;
+    _replayRequested = false;
+    _replaying = false;
+}
+
+void begin()
+{
+    _ticks = 0;
+
+    if (_replayRequested)
+    {
+        _replayRequested = false;
+        _replaying = true;
+
+        rng::seed(_replaySeed);
+        game::setTickMilliseconds(_replayTickMilliseconds);
+
+        cout << "Replaying game with seed " << _replaySeed << endl;
+        return;
+    }
+
+    if (_recordRequested)
+    {
+        _recordRequested = false;
+        _recording = true;
+
+        // Restarts the streams, so that the seed alone reproduces them.
+        rng::seed(rng::getSeed());
+
+        _recordFile.write(_MAGIC, sizeof(_MAGIC));
+        _write(_VERSION, 1);
+        _write(rng::getSeed(), 8);
+        _write(game::getTickMilliseconds(), 2);
+
+        cout << "Recording game to " << _recordPath << endl;
+    }
+}
+
+void update()
+{
+    if (!game::isRunning())
+    {
+        if (_recording)
+        {
+            _recording = false;
+            _recordFile.close();
+
+            cout << "Recorded " << _ticks << " ticks to " << _recordPath;
+            cout << endl;
+        }
+
+        if (_replaying)
+        {
+            _replaying = false;
+            _replayFile.close();
+
+            cout << "Replayed " << _ticks << " ticks" << endl;
+        }
+
+        return;
+    }
+
+    if (_replaying)
+    {
+        if (!_readTick()) return;
+    }
+    else
+        _sample();
+
+    if (_recording) _writeTick();
+
+    _ticks++;
+}
+
+bool isPressed(Key key)
+{
+    return _keys[key];
+}
+
+void getMousePosition(int* x, int* y)
+{
+    *x = _mouseX;
+    *y = _mouseY;
+}
+
+void record(const char* path)
+{
+    _recordFile.open(path, ios::binary | ios::trunc);
+
+    if (!_recordFile)
+    {
+        cerr << "Failed to open " << path << " for recording" << endl;
+        exit(1);
+    }
+
+    _recordPath = path;
+    _recordRequested = true;
+}
+
+void replay(const char* path)
+{
+    _replayFile.open(path, ios::binary);
+
+    char magic[sizeof(_MAGIC)];
+    unsigned long long version, tickMilliseconds;
+
+    _replayFile.read(magic, sizeof(magic));
+
+    bool valid = _replayFile && !memcmp(magic, _MAGIC, sizeof(_MAGIC));
+
+    valid = valid && _read(1, &version) && version == _VERSION;
+    valid = valid && _read(8, &_replaySeed);
+    valid = valid && _read(2, &tickMilliseconds) && tickMilliseconds > 0;
+
+    if (!valid)
+    {
+        cerr << "Failed to read replay " << path << endl;
+        exit(1);
+    }
+
+    _replayTickMilliseconds = tickMilliseconds;
+    _replayRequested = true;
+}
+
+bool isReplaying()
+{
+    return _replayRequested || _replaying;
+}
+
+void _sample()
+{
+    // There are no input devices in the headless build, so the player stays
+    // still and keeps shooting in the same direction.
+#ifndef SMOCC_HEADLESS
+    const Uint8* keys = SDL_GetKeyboardState(NULL);
+
+    _keys[UP] = keys[SDL_SCANCODE_W] || keys[SDL_SCANCODE_UP];
+    _keys[DOWN] = keys[SDL_SCANCODE_S] || keys[SDL_SCANCODE_DOWN];
+    _keys[LEFT] = keys[SDL_SCANCODE_A] || keys[SDL_SCANCODE_LEFT];
+    _keys[RIGHT] = keys[SDL_SCANCODE_D] || keys[SDL_SCANCODE_RIGHT];
+
+    SDL_GetMouseState(&_mouseX, &_mouseY);
+#endif
+}
+
+void _writeTick()
+{
+    unsigned char flags = 0;
+
+    for (unsigned int i = 0; i < _KEYS_COUNT; i++)
+        if (_keys[i]) flags |= 1 << i;
+
+    bool mouseMoved = _mouseX != _recordedMouseX;
+
+    mouseMoved = mouseMoved || _mouseY != _recordedMouseY;
+    mouseMoved = mouseMoved || _ticks == 0;
+
+    if (mouseMoved) flags |= _MOUSE_MOVED_FLAG;
+
+    _write(game::getDeltaTimeMilliseconds(), 1);
+    _write(flags, 1);
+
+    if (!mouseMoved) return;
+
+    _write((unsigned short)_mouseX, 2);
+    _write((unsigned short)_mouseY, 2);
+
+    _recordedMouseX = _mouseX;
+    _recordedMouseY = _mouseY;
+}
+
+bool _readTick()
+{
+    unsigned long long deltaTime, flags, x, y;
+
+    if (!_read(1, &deltaTime) || !_read(1, &flags))
+    {
+        _stopReplay("Replay ended before the game did");
+        return false;
+    }
+
+    if (deltaTime != game::getDeltaTimeMilliseconds())
+    {
+        _stopReplay("Replay out of sync with the game clock");
+        return false;
+    }
+
+    for (unsigned int i = 0; i < _KEYS_COUNT; i++)
+        _keys[i] = flags & 1 << i;
+
+    if (!(flags & _MOUSE_MOVED_FLAG)) return true;
+
+    if (!_read(2, &x) || !_read(2, &y))
+    {
+        _stopReplay("Replay ended before the game did");
+        return false;
+    }
+
+    _mouseX = (short)x;
+    _mouseY = (short)y;
+
+    return true;
+}
+
+void _stopReplay(const char* reason)
+{
+    cerr << reason << ", at tick " << _ticks << endl;
+
+    memset(_keys, 0, sizeof(_keys));
+
+    game::end();
+    ui::game_over::show();
+}
+
+void _write(unsigned long long value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        _recordFile.put((char)(value >> (8 * i) & 0xFF));
+}
+
+bool _read(int bytes, unsigned long long* value)
+{
+    *value = 0;
+
+    for (int i = 0; i < bytes; i++)
+    {
+        int c = _replayFile.get();
+
+        if (c == EOF) return false;
+
+        *value |= (unsigned long long)c << (8 * i);
+    }
+
+    return true;
+}
+
+} // namespace smocc::input
@@ -0,0 +1,48 @@
+/*
+
+input.h: Game input sampling, recording and replay for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#pragma once
+
+namespace smocc::input
+{
+
+enum Key
+{
+    UP,
+    DOWN,
+    LEFT,
+    RIGHT
+};
+
+void init();
+
+// Called by game::begin. Starts the recording or the replay, if requested and
+// not done yet, reseeding the random number generators so that the game can
+// be played again identically.
+void begin();
+
+// Samples the input for the current simulation tick. While recording, the
+// sampled input is also written to the replay file. While replaying, the input
+// is read from the replay file instead of the devices.
+void update();
+
+bool isPressed(Key key);
+void getMousePosition(int* x, int* y);
+
+// Records the input of the next game to the file at the given path.
+void record(const char* path);
+
+// Replays the input of the next game from the file at the given path, created
+// by `record`. Exits with an error if the file can't be read.
+void replay(const char* path);
+
+bool isReplaying();
+
+} // namespace smocc::input
@@ -0,0 +1,182 @@
+/*
+
+pacer.cc: Frame pacing for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#include <SDL.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "pacer.h"
+#include "smocc.h"
+
+using namespace std;
+
+namespace smocc::pacer
+{
+
+// Sleeping is left for waits longer than this, as the scheduler can wake the
+// game up late by around a millisecond.
+const double _SPIN_MILLISECONDS = 2.0;
+
+double _millisecondsPerCount;
+unsigned int _frameRate;
+unsigned long long _period;
+unsigned long long _deadline;
+unsigned long long _frameStart;
+unsigned long long _busyEnd;
+bool _vsync = false;
+
+// Frame and busy times of the recent frames, in counter units, as ring buffers.
+vector<unsigned long long> _frameTimes;
+vector<unsigned long long> _busyTimes;
+unsigned int _statsCursor;
+unsigned int _statsFrames;
+
+void _wait(unsigned long long deadline);
+void _record(unsigned long long frameTime, unsigned long long busyTime);
+
+void init()
+{
+    _millisecondsPerCount = 1000.0 / SDL_GetPerformanceFrequency();
+    _deadline = SDL_GetPerformanceCounter();
+    _frameStart = _deadline;
+    _busyEnd = 0;
+    _frameTimes.assign(STATS_FRAMES, 0);
+    _busyTimes.assign(STATS_FRAMES, 0);
+    _statsCursor = 0;
+    _statsFrames = 0;
+
+    setFrameRate(DEFAULT_FRAME_RATE);
+}
+
+void setFrameRate(unsigned int framesPerSecond)
+{
+    _frameRate = framesPerSecond;
+
+    if (framesPerSecond == 0)
+    {
+        _period = 0;
+        return;
+    }
+
+    _period = SDL_GetPerformanceFrequency() / framesPerSecond;
+}
+
+unsigned int getFrameRate()
+{
+    return _frameRate;
+}
+
+void enableVsync()
+{
+    if (SDL_RenderSetVSync(smocc::getRenderer(), 1))
+    {
+        cerr << "Failed to enable vsync: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    _vsync = true;
+}
+
+bool isVsyncEnabled()
+{
+    return _vsync;
+}
+
+void beginFrame()
+{
+    _frameStart = SDL_GetPerformanceCounter();
+    _busyEnd = 0;
+}
+
+void endBusy()
+{
+    _busyEnd = SDL_GetPerformanceCounter();
+}
+
+void endFrame()
+{
+    unsigned long long now = SDL_GetPerformanceCounter();
+    unsigned long long busyEnd = _busyEnd ? _busyEnd : now;
+
+    if (_period > 0)
+    {
+        // Deadlines follow each other by exactly a period, so that waking up
+        // late from a wait doesn't make the next frame late too. Deadlines
+        // missed by over a period, as after a hitch, are given up on.
+        _deadline += _period;
+
+        if (_deadline + _period < now) _deadline = now;
+
+        _wait(_deadline);
+    }
+
+    unsigned long long frameEnd = SDL_GetPerformanceCounter();
+
+    _record(frameEnd - _frameStart, busyEnd - _frameStart);
+}
+
+Stats getStats()
+{
+    Stats stats = {0, 0, 0, 0, 0};
+
+    if (_statsFrames == 0) return stats;
+
+    unsigned long long frameTotal = 0;
+    unsigned long long busyTotal = 0;
+    unsigned long long frameMax = 0;
+
+    for (unsigned int i = 0; i < _statsFrames; i++)
+    {
+        frameTotal += _frameTimes[i];
+        busyTotal += _busyTimes[i];
+        frameMax = max(frameMax, _frameTimes[i]);
+    }
+
+    double frameAverage = frameTotal * _millisecondsPerCount / _statsFrames;
+
+    stats.averageFrameMilliseconds = frameAverage;
+    stats.maxFrameMilliseconds = frameMax * _millisecondsPerCount;
+    stats.averageBusyMilliseconds =
+        busyTotal * _millisecondsPerCount / _statsFrames;
+
+    if (frameAverage > 0) stats.framesPerSecond = 1000.0 / frameAverage;
+
+    unsigned int last = (_statsCursor + STATS_FRAMES - 1) % STATS_FRAMES;
+
+    stats.lastBusyMilliseconds = _busyTimes[last] * _millisecondsPerCount;
+
+    return stats;
+}
+
+void _wait(unsigned long long deadline)
+{
+    while (true)
+    {
+        unsigned long long now = SDL_GetPerformanceCounter();
+
+        if (now >= deadline) return;
+
+        double remaining = (deadline - now) * _millisecondsPerCount;
+
+        if (remaining > _SPIN_MILLISECONDS + 1)
+            SDL_Delay(remaining - _SPIN_MILLISECONDS);
+    }
+}
+
+void _record(unsigned long long frameTime, unsigned long long busyTime)
+{
+    _frameTimes[_statsCursor] = frameTime;
+    _busyTimes[_statsCursor] = busyTime;
+    _statsCursor = (_statsCursor + 1) % STATS_FRAMES;
+    _statsFrames = min(_statsFrames + 1, STATS_FRAMES);
+}
+
+} // namespace smocc::pacer
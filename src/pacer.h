@@ -0,0 +1,58 @@
+/*
+
+pacer.h: Frame pacing for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#pragma once
+
+namespace smocc::pacer
+{
+
+const unsigned int DEFAULT_FRAME_RATE = 125;
+
+// Number of frames the statistics are computed over.
+const unsigned int STATS_FRAMES = 120;
+
+struct Stats
+{
+    double framesPerSecond;
+
+    // Time from the start of a frame to the start of the next one.
+    double averageFrameMilliseconds;
+    double maxFrameMilliseconds;
+
+    // Time from the start of a frame to the end of its work, before it's
+    // presented, which with vsync waits for the display refresh.
+    double averageBusyMilliseconds;
+    double lastBusyMilliseconds;
+};
+
+void init();
+
+// Sets the frame rate to pace frames at, or 0 to not wait between frames.
+void setFrameRate(unsigned int framesPerSecond);
+unsigned int getFrameRate();
+
+// Makes presenting wait for the display refresh. Frames are still paced at the
+// frame rate, if lower than the refresh rate.
+void enableVsync();
+bool isVsyncEnabled();
+
+void beginFrame();
+
+// Marks the end of the frame's work, before it's presented. Frames not marked
+// end their work when they end.
+void endBusy();
+
+// Waits until the time the next frame is due, sleeping while it's far and
+// spinning for the last stretch, which sleeping can overshoot.
+void endFrame();
+
+Stats getStats();
+
+} // namespace smocc::pacer
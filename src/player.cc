@@ -10,6 +10,7 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 
 #include <SDL.h>
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include "buffs.h"
@@ -17,6 +18,7 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 #include "colors.h"
 #include "game.h"
 #include "gfx.h"
+#include "input.h"
 #include "player.h"
 #include "smocc.h"
 
@@ -33,10 +35,17 @@ unsigned long long _bulletSourceID;
 bool _spawned;
 double _x;
 double _y;
+double _previousX;
+double _previousY;
+bool _invulnerable;
+
+void _move(unsigned int deltaTimeMilliseconds);
+void _aim();
 
 void init()
 {
     _spawned = false;
+    _invulnerable = false;
 }
 
 void spawn()
@@ -46,13 +55,14 @@ void spawn()
 
     _bulletSourceID = bullets::createSource();
 
-    SDL_Window* window = smocc::getWindow();
     int w, h;
 
-    SDL_GetWindowSize(window, &w, &h);
+    smocc::getWorldSize(&w, &h);
 
     _x = w / 2;
     _y = h / 2;
+    _previousX = _x;
+    _previousY = _y;
 
     bullets::setSourcePosition(_bulletSourceID, _x, _y);
 }
@@ -74,49 +84,40 @@ void update()
 
     unsigned int deltaTimeMilliseconds = game::getDeltaTimeMilliseconds();
 
-    const Uint8* keys = SDL_GetKeyboardState(NULL);
-
-    if (keys[SDL_SCANCODE_W] || keys[SDL_SCANCODE_UP])
-        _y -= PLAYER_SPEED * deltaTimeMilliseconds;
-
-    if (keys[SDL_SCANCODE_S] || keys[SDL_SCANCODE_DOWN])
-        _y += PLAYER_SPEED * deltaTimeMilliseconds;
-
-    if (keys[SDL_SCANCODE_A] || keys[SDL_SCANCODE_LEFT])
-        _x -= PLAYER_SPEED * deltaTimeMilliseconds;
+    _previousX = _x;
+    _previousY = _y;
 
-    if (keys[SDL_SCANCODE_D] || keys[SDL_SCANCODE_RIGHT])
-        _x += PLAYER_SPEED * deltaTimeMilliseconds;
+    _move(deltaTimeMilliseconds);
 
-    SDL_Window* window = smocc::getWindow();
+    int worldWidth, worldHeight;
 
-    int windowWidth, windowHeight;
-    SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+    smocc::getWorldSize(&worldWidth, &worldHeight);
 
     double minX = PLAYER_CIRCLE_RADIUS;
     double minY = PLAYER_CIRCLE_RADIUS;
-    double maxX = windowWidth - PLAYER_CIRCLE_RADIUS;
-    double maxY = windowHeight - PLAYER_CIRCLE_RADIUS;
+    double maxX = worldWidth - PLAYER_CIRCLE_RADIUS;
+    double maxY = worldHeight - PLAYER_CIRCLE_RADIUS;
 
     _x = clamp(_x, minX, maxX);
     _y = clamp(_y, minY, maxY);
 
     bullets::setSourcePosition(_bulletSourceID, _x, _y);
 
-    double xDirection;
-    double yDirection;
-    int xMouse;
-    int yMouse;
-
-    SDL_GetMouseState(&xMouse, &yMouse);
+    _aim();
+}
 
-    gfx::direction(_x, _y, xMouse, yMouse, &xDirection, &yDirection);
+void render()
+{
+    if (!_spawned) return;
+    if (!game::isRunning()) return;
 
-    bullets::setSourceDirection(_bulletSourceID, xDirection, yDirection);
+    double t = game::getInterpolation();
+    double x = lerp(_previousX, _x, t);
+    double y = lerp(_previousY, _y, t);
 
     gfx::setDrawColor(&_PLAYER_COLOR);
     gfx::setDrawBlendMode(SDL_BLENDMODE_BLEND);
-    gfx::fillCircle(_x, _y, PLAYER_CIRCLE_RADIUS);
+    gfx::fillCircle(x, y, PLAYER_CIRCLE_RADIUS);
 }
 
 double getXPosition()
@@ -129,4 +130,43 @@ double getYPosition()
     return _y;
 }
 
+void setInvulnerable(bool invulnerable)
+{
+    _invulnerable = invulnerable;
+}
+
+bool isInvulnerable()
+{
+    return _invulnerable;
+}
+
+void _move(unsigned int deltaTimeMilliseconds)
+{
+    if (input::isPressed(input::UP))
+        _y -= PLAYER_SPEED * deltaTimeMilliseconds;
+
+    if (input::isPressed(input::DOWN))
+        _y += PLAYER_SPEED * deltaTimeMilliseconds;
+
+    if (input::isPressed(input::LEFT))
+        _x -= PLAYER_SPEED * deltaTimeMilliseconds;
+
+    if (input::isPressed(input::RIGHT))
+        _x += PLAYER_SPEED * deltaTimeMilliseconds;
+}
+
+void _aim()
+{
+    double xDirection;
+    double yDirection;
+    int xMouse;
+    int yMouse;
+
+    input::getMousePosition(&xMouse, &yMouse);
+
+    gfx::direction(_x, _y, xMouse, yMouse, &xDirection, &yDirection);
+
+    bullets::setSourceDirection(_bulletSourceID, xDirection, yDirection);
+}
+
 } // namespace smocc::player
@@ -19,7 +19,12 @@ const int PLAYER_CIRCLE_RADIUS = 3;
 void init();
 void spawn();
 void update();
+void render();
 double getXPosition();
 double getYPosition();
 
+// Makes enemies pass through the player instead of ending the game.
+void setInvulnerable(bool invulnerable);
+bool isInvulnerable();
+
 } // namespace smocc::player
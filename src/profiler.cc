@@ -0,0 +1,265 @@
+/*
+
+profiler.cc: Per-module frame profiler for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#include <SDL.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gfx.h"
+#include "pacer.h"
+#include "profiler.h"
+#include "resolution.h"
+#include "ui/text.h"
+
+using namespace std;
+
+namespace smocc::profiler
+{
+
+const unsigned int _OVERLAY_REFRESH_MILLISECONDS = 500;
+const int _OVERLAY_MARGIN_PIXELS = 10;
+const int _OVERLAY_PADDING_PIXELS = 6;
+const SDL_Color _OVERLAY_BACKGROUND_COLOR = {255, 255, 255, 220};
+const char* _FRAME_SECTION = "frame";
+
+struct Section
+{
+    const char* name;
+
+    // Time spent in the current frame, in performance counter units.
+    unsigned long long frameTime;
+
+    // Times of the recent frames, in microseconds, as a ring buffer.
+    vector<double> history;
+};
+
+vector<Section> _sections;
+unsigned int _historyFrames;
+unsigned int _historyCursor;
+unsigned long long _frame;
+unsigned long long _frameStart;
+double _microsecondsPerCount;
+
+bool _overlayVisible;
+unsigned long long _overlayRefreshTime;
+vector<string> _overlayLines;
+
+ofstream _csv;
+
+unsigned int _getSection(const char* name);
+void _refreshOverlay();
+double _percentile(const Section& section, double p, vector<double>* scratch);
+
+Scope::Scope(const char* section)
+{
+    this->section = _getSection(section);
+    this->start = SDL_GetPerformanceCounter();
+}
+
+Scope::~Scope()
+{
+    _sections[section].frameTime += SDL_GetPerformanceCounter() - start;
+}
+
+void init()
+{
+    _microsecondsPerCount = 1e6 / SDL_GetPerformanceFrequency();
+    _historyFrames = 0;
+    _historyCursor = 0;
+    _frame = 0;
+    _overlayVisible = false;
+    _overlayRefreshTime = 0;
+
+    _getSection(_FRAME_SECTION);
+}
+
+void measure(const char* section, void (*function)())
+{
+    Scope scope(section);
+
+    function();
+}
+
+void beginFrame()
+{
+    _frameStart = SDL_GetPerformanceCounter();
+}
+
+void endFrame()
+{
+    unsigned long long frameTime = SDL_GetPerformanceCounter() - _frameStart;
+
+    _sections[_getSection(_FRAME_SECTION)].frameTime = frameTime;
+
+    for (Section& section : _sections)
+    {
+        double microseconds = section.frameTime * _microsecondsPerCount;
+
+        section.history[_historyCursor] = microseconds;
+        section.frameTime = 0;
+
+        if (!_csv.is_open()) continue;
+
+        _csv << _frame << "," << section.name << "," << microseconds << "\n";
+    }
+
+    _historyCursor = (_historyCursor + 1) % HISTORY_FRAMES;
+    _historyFrames = min(_historyFrames + 1, HISTORY_FRAMES);
+    _frame++;
+}
+
+void render()
+{
+    if (!_overlayVisible) return;
+
+    unsigned long long time = SDL_GetTicks64();
+
+    if (time >= _overlayRefreshTime)
+    {
+        _refreshOverlay();
+        _overlayRefreshTime = time + _OVERLAY_REFRESH_MILLISECONDS;
+    }
+
+    int w = 0;
+    int h = 0;
+
+    for (const string& line : _overlayLines)
+    {
+        SDL_Rect size = ui::text::size(line.c_str());
+
+        w = max(w, size.w);
+        h += size.h;
+    }
+
+    SDL_Rect background;
+    background.x = _OVERLAY_MARGIN_PIXELS;
+    background.y = _OVERLAY_MARGIN_PIXELS;
+    background.w = w + 2 * _OVERLAY_PADDING_PIXELS;
+    background.h = h + 2 * _OVERLAY_PADDING_PIXELS;
+
+    SDL_Color backgroundColor = _OVERLAY_BACKGROUND_COLOR;
+
+    gfx::setDrawColor(&backgroundColor);
+    gfx::setDrawBlendMode(SDL_BLENDMODE_BLEND);
+    gfx::fillRect(&background);
+
+    int x = background.x + _OVERLAY_PADDING_PIXELS;
+    int y = background.y + _OVERLAY_PADDING_PIXELS;
+
+    for (const string& line : _overlayLines)
+    {
+        ui::text::draw(line.c_str(), x, y);
+        y += ui::text::size(line.c_str()).h;
+    }
+}
+
+void toggleOverlay()
+{
+    _overlayVisible = !_overlayVisible;
+    _overlayRefreshTime = 0;
+
+    if (!_overlayVisible) _overlayLines.clear();
+}
+
+bool isOverlayVisible()
+{
+    return _overlayVisible;
+}
+
+void dumpCSV(const char* path)
+{
+    _csv.open(path, ios::trunc);
+
+    if (!_csv)
+    {
+        cerr << "Failed to open " << path << " for the profiler dump" << endl;
+        exit(1);
+    }
+
+    _csv << "frame,section,microseconds\n";
+}
+
+unsigned int _getSection(const char* name)
+{
+    unsigned int n = _sections.size();
+
+    for (unsigned int i = 0; i < n; i++)
+        if (_sections[i].name == name) return i;
+
+    Section section;
+    section.name = name;
+    section.frameTime = 0;
+    section.history.assign(HISTORY_FRAMES, 0);
+
+    _sections.push_back(section);
+
+    return n;
+}
+
+void _refreshOverlay()
+{
+    _overlayLines.clear();
+
+    char line[80];
+    vector<double> scratch;
+    smocc::pacer::Stats stats = smocc::pacer::getStats();
+
+    snprintf(
+        line, sizeof(line), "%.1f fps, %.2f ms avg, %.2f ms max, %.2f ms busy",
+        stats.framesPerSecond, stats.averageFrameMilliseconds,
+        stats.maxFrameMilliseconds, stats.averageBusyMilliseconds
+    );
+    _overlayLines.push_back(line);
+
+    if (smocc::resolution::isEnabled())
+    {
+        double scale = smocc::resolution::getScale();
+
+        snprintf(line, sizeof(line), "playfield at %.0f%%", scale * 100);
+        _overlayLines.push_back(line);
+    }
+
+    snprintf(line, sizeof(line), "%-16s %9s %9s", "", "p50 ms", "p99 ms");
+    _overlayLines.push_back(line);
+
+    for (const Section& section : _sections)
+    {
+        double p50 = _percentile(section, 0.50, &scratch) / 1000;
+        double p99 = _percentile(section, 0.99, &scratch) / 1000;
+
+        snprintf(
+            line, sizeof(line), "%-16s %9.3f %9.3f", section.name, p50, p99
+        );
+
+        _overlayLines.push_back(line);
+    }
+}
+
+double _percentile(const Section& section, double p, vector<double>* scratch)
+{
+    if (_historyFrames == 0) return 0;
+
+    scratch->assign(
+        section.history.begin(), section.history.begin() + _historyFrames
+    );
+
+    auto nth = scratch->begin() + (unsigned int)(p * (_historyFrames - 1));
+
+    nth_element(scratch->begin(), nth, scratch->end());
+
+    return *nth;
+}
+
+} // namespace smocc::profiler
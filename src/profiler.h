@@ -0,0 +1,53 @@
+/*
+
+profiler.h: Per-module frame profiler for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#pragma once
+
+namespace smocc::profiler
+{
+
+// Number of frames kept in the history of each section.
+const unsigned int HISTORY_FRAMES = 240;
+
+// Adds the time from its construction to its destruction to the given section
+// of the current frame. Sections are created on first use, and are identified
+// by the address of their name, which should be a string literal.
+struct Scope
+{
+    Scope(const char* section);
+    ~Scope();
+
+    unsigned int section;
+    unsigned long long start;
+};
+
+void init();
+
+// Measures a call to the given function into a section.
+void measure(const char* section, void (*function)());
+
+void beginFrame();
+
+// Stores the time of each section in the current frame into its history, and
+// appends it to the CSV dump, if any.
+void endFrame();
+
+// Draws a table with the 50th and 99th percentile times of each section over
+// the recent frames, if the overlay is visible.
+void render();
+
+void toggleOverlay();
+bool isOverlayVisible();
+
+// Writes the time of each section in every frame to a CSV file at the given
+// path, with columns for frame number, section and microseconds.
+void dumpCSV(const char* path);
+
+} // namespace smocc::profiler
@@ -0,0 +1,511 @@
+/*
+
+raster.cc: Software rasterizer for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "gfx.h"
+#include "raster.h"
+#include "smocc.h"
+
+using namespace std;
+
+namespace smocc::raster
+{
+
+const unsigned long long _FNV_OFFSET_BASIS = 0xCBF29CE484222325;
+const unsigned long long _FNV_PRIME = 0x100000001B3;
+
+bool _enabled = false;
+int _width;
+int _height;
+vector<Uint32> _pixels;
+
+// Coverage of the pixels of a span, from 0 to 255. The buffers are padded to a
+// multiple of four pixels, so that the vector kernels need no scalar tail.
+vector<Uint8> _coverage;
+vector<Uint8> _fullCoverage;
+
+// Bounds of the pixels drawn since the last upload or clear, with the right and
+// bottom bounds excluded. Pixels outside of them are transparent.
+int _dirtyLeft;
+int _dirtyTop;
+int _dirtyRight;
+int _dirtyBottom;
+
+SDL_Texture* _texture = nullptr;
+
+Uint32 _premultiply(SDL_Color c, SDL_BlendMode mode);
+Uint32 _div255(Uint32 x);
+void _markDirty(int x1, int y1, int x2, int y2);
+void _resetDirty();
+void _blendSpan(Uint32* pixels, const Uint8* coverage, int n, Uint32 color);
+void _circleCoverage(float dx, float dy, float radius, int n, Uint8* coverage);
+void _lineCoverage(
+    float vx, float vy, float dx, float dy, float inverseLength2, int n,
+    Uint8* coverage
+);
+
+#ifdef __SSE2__
+__m128i _div255(__m128i x);
+__m128i _blend(__m128i pixels, __m128i color, __m128i coverage);
+__m128 _pixelOffsets(int i);
+void _storeCoverage(__m128 coverage, Uint8* out);
+#endif
+
+void init(int width, int height)
+{
+    _enabled = true;
+    _width = width;
+    _height = height;
+    _pixels.assign(width * height, 0);
+    _coverage.assign(width + 4, 0);
+    _fullCoverage.assign(width + 4, 255);
+
+    _resetDirty();
+}
+
+bool isEnabled()
+{
+    return _enabled;
+}
+
+int getWidth()
+{
+    return _width;
+}
+
+int getHeight()
+{
+    return _height;
+}
+
+const Uint32* getPixels()
+{
+    return _pixels.data();
+}
+
+unsigned long long hash()
+{
+    unsigned long long h = _FNV_OFFSET_BASIS;
+
+    // Bytes are hashed in little endian order, whatever the machine.
+    for (Uint32 pixel : _pixels)
+    {
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            h ^= (pixel >> shift) & 0xFF;
+            h *= _FNV_PRIME;
+        }
+    }
+
+    return h;
+}
+
+void clear()
+{
+    if (!isDirty()) return;
+
+    int n = _dirtyRight - _dirtyLeft;
+
+    for (int y = _dirtyTop; y < _dirtyBottom; y++)
+        memset(&_pixels[y * _width + _dirtyLeft], 0, n * sizeof(Uint32));
+
+    _resetDirty();
+}
+
+void fillRect(int x, int y, int w, int h, SDL_Color c, SDL_BlendMode mode)
+{
+    int x1 = max(x, 0);
+    int y1 = max(y, 0);
+    int x2 = min(x + w, _width);
+    int y2 = min(y + h, _height);
+
+    if (x1 >= x2 || y1 >= y2) return;
+
+    Uint32 color = _premultiply(c, mode);
+
+    for (int py = y1; py < y2; py++)
+    {
+        Uint32* row = &_pixels[py * _width + x1];
+
+        _blendSpan(row, _fullCoverage.data(), x2 - x1, color);
+    }
+
+    _markDirty(x1, y1, x2, y2);
+}
+
+void fillCircle(
+    float x, float y, float radius, SDL_Color c, SDL_BlendMode mode
+)
+{
+    if (radius <= 0) return;
+
+    // Pixels are covered up to half a pixel past the radius.
+    float reach = radius + 0.5f;
+    int y1 = max((int)floor(y - reach), 0);
+    int y2 = min((int)ceil(y + reach), _height);
+    int left = _width;
+    int right = 0;
+
+    Uint32 color = _premultiply(c, mode);
+
+    for (int py = y1; py < y2; py++)
+    {
+        float dy = py + 0.5f - y;
+        float halfChord = sqrt(max(reach * reach - dy * dy, 0.0f));
+        int x1 = max((int)floor(x - halfChord - 0.5f), 0);
+        int x2 = min((int)ceil(x + halfChord + 0.5f), _width);
+
+        if (x1 >= x2) continue;
+
+        float dx = x1 + 0.5f - x;
+        Uint8* coverage = _coverage.data();
+
+        _circleCoverage(dx, dy, radius, x2 - x1, coverage);
+        _blendSpan(&_pixels[py * _width + x1], coverage, x2 - x1, color);
+
+        left = min(left, x1);
+        right = max(right, x2);
+    }
+
+    if (left < right) _markDirty(left, y1, right, y2);
+}
+
+void drawLine(
+    float x1, float y1, float x2, float y2, SDL_Color c, SDL_BlendMode mode
+)
+{
+    float dx = x2 - x1;
+    float dy = y2 - y1;
+    float length2 = dx * dx + dy * dy;
+    float inverseLength2 = length2 > 0 ? 1 / length2 : 0;
+
+    // Pixels are covered up to a pixel away from the line.
+    int top = max((int)floor(min(y1, y2) - 1), 0);
+    int bottom = min((int)ceil(max(y1, y2) + 1), _height);
+    int left = _width;
+    int right = 0;
+
+    Uint32 color = _premultiply(c, mode);
+
+    for (int py = top; py < bottom; py++)
+    {
+        float cy = py + 0.5f;
+
+        // Finds the part of the line within a pixel from the row center.
+        float t1 = 0;
+        float t2 = 1;
+
+        if (dy != 0)
+        {
+            t1 = clamp((cy - 1 - y1) / dy, 0.0f, 1.0f);
+            t2 = clamp((cy + 1 - y1) / dy, 0.0f, 1.0f);
+        }
+
+        float xa = x1 + t1 * dx;
+        float xb = x1 + t2 * dx;
+        int px1 = max((int)floor(min(xa, xb) - 1), 0);
+        int px2 = min((int)ceil(max(xa, xb) + 1), _width);
+
+        if (px1 >= px2) continue;
+
+        float vx = px1 + 0.5f - x1;
+        float vy = cy - y1;
+        Uint8* coverage = _coverage.data();
+
+        _lineCoverage(vx, vy, dx, dy, inverseLength2, px2 - px1, coverage);
+        _blendSpan(&_pixels[py * _width + px1], coverage, px2 - px1, color);
+
+        left = min(left, px1);
+        right = max(right, px2);
+    }
+
+    if (left < right) _markDirty(left, top, right, bottom);
+}
+
+bool isDirty()
+{
+    return _dirtyLeft < _dirtyRight && _dirtyTop < _dirtyBottom;
+}
+
+SDL_Texture* upload(SDL_Rect* rect)
+{
+    SDL_Renderer* renderer = smocc::getRenderer();
+
+    if (!_texture)
+    {
+        _texture = SDL_CreateTexture(
+            renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+            _width, _height
+        );
+
+        if (!_texture)
+        {
+            cerr << "Failed to create framebuffer texture: " << SDL_GetError()
+                 << endl;
+            exit(1);
+        }
+
+        SDL_BlendMode blendMode = gfx::premultipliedBlendMode();
+
+        if (SDL_SetTextureBlendMode(_texture, blendMode))
+        {
+            cerr << "Failed to set framebuffer blend mode: " << SDL_GetError()
+                 << endl;
+            exit(1);
+        }
+    }
+
+    rect->x = _dirtyLeft;
+    rect->y = _dirtyTop;
+    rect->w = _dirtyRight - _dirtyLeft;
+    rect->h = _dirtyBottom - _dirtyTop;
+
+    const Uint32* pixels = &_pixels[_dirtyTop * _width + _dirtyLeft];
+    int pitch = _width * sizeof(Uint32);
+
+    if (SDL_UpdateTexture(_texture, rect, pixels, pitch))
+    {
+        cerr << "Failed to upload framebuffer: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    clear();
+
+    return _texture;
+}
+
+Uint32 _premultiply(SDL_Color c, SDL_BlendMode mode)
+{
+    // Without blending, the color replaces the pixels it fully covers.
+    Uint32 a = mode == SDL_BLENDMODE_NONE ? 255 : c.a;
+    Uint32 r = _div255(c.r * a);
+    Uint32 g = _div255(c.g * a);
+    Uint32 b = _div255(c.b * a);
+
+    // Additive blending is alpha blending of a premultiplied color with no
+    // alpha, which leaves the destination unattenuated.
+    if (mode == SDL_BLENDMODE_ADD) a = 0;
+
+    return a << 24 | r << 16 | g << 8 | b;
+}
+
+// Divides by 255, rounding to the nearest, for values up to 255 * 255.
+Uint32 _div255(Uint32 x)
+{
+    return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+void _markDirty(int x1, int y1, int x2, int y2)
+{
+    _dirtyLeft = min(_dirtyLeft, x1);
+    _dirtyTop = min(_dirtyTop, y1);
+    _dirtyRight = max(_dirtyRight, x2);
+    _dirtyBottom = max(_dirtyBottom, y2);
+}
+
+void _resetDirty()
+{
+    _dirtyLeft = _width;
+    _dirtyTop = _height;
+    _dirtyRight = 0;
+    _dirtyBottom = 0;
+}
+
+// Blends the premultiplied color, scaled by the coverage of each pixel, over
+// the pixels: d = s * c + d * (1 - s.a * c), saturated.
+void _blendSpan(Uint32* pixels, const Uint8* coverage, int n, Uint32 color)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128();
+    __m128i color16 = _mm_unpacklo_epi8(_mm_set1_epi32(color), zero);
+
+    for (; i + 4 <= n; i += 4)
+    {
+        Uint32 coverage4;
+
+        memcpy(&coverage4, coverage + i, sizeof(coverage4));
+
+        if (coverage4 == 0) continue;
+
+        // Spreads the coverage of each pixel over its four channels.
+        __m128i c = _mm_unpacklo_epi8(_mm_cvtsi32_si128(coverage4), zero);
+        c = _mm_unpacklo_epi16(c, c);
+
+        __m128i c01 = _mm_unpacklo_epi32(c, c);
+        __m128i c23 = _mm_unpackhi_epi32(c, c);
+
+        __m128i* p = (__m128i*)(pixels + i);
+        __m128i d = _mm_loadu_si128(p);
+        __m128i d01 = _blend(_mm_unpacklo_epi8(d, zero), color16, c01);
+        __m128i d23 = _blend(_mm_unpackhi_epi8(d, zero), color16, c23);
+
+        _mm_storeu_si128(p, _mm_packus_epi16(d01, d23));
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        if (coverage[i] == 0) continue;
+
+        Uint32 sa = _div255((color >> 24) * coverage[i]);
+        Uint32 d = pixels[i];
+        Uint32 result = 0;
+
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            Uint32 s = _div255((color >> shift & 0xFF) * coverage[i]);
+            Uint32 channel = s + _div255((d >> shift & 0xFF) * (255 - sa));
+
+            result |= min(channel, 255u) << shift;
+        }
+
+        pixels[i] = result;
+    }
+}
+
+// Computes the coverage of `n` pixels of a row by a circle, where `dx` and `dy`
+// are the offsets of the center of the first pixel from the circle center.
+void _circleCoverage(float dx, float dy, float radius, int n, Uint8* coverage)
+{
+    float reach = radius + 0.5f;
+    float dy2 = dy * dy;
+
+#ifdef __SSE2__
+    __m128 dxs = _mm_set1_ps(dx);
+    __m128 dy2s = _mm_set1_ps(dy2);
+    __m128 reachs = _mm_set1_ps(reach);
+
+    for (int i = 0; i < n; i += 4)
+    {
+        __m128 x = _mm_add_ps(dxs, _pixelOffsets(i));
+        __m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), dy2s));
+
+        _storeCoverage(_mm_sub_ps(reachs, d), coverage + i);
+    }
+#else
+    for (int i = 0; i < n; i++)
+    {
+        float x = dx + i;
+        float d = sqrt(x * x + dy2);
+
+        coverage[i] = nearbyint(clamp(reach - d, 0.0f, 1.0f) * 255);
+    }
+#endif
+}
+
+// Computes the coverage of `n` pixels of a row by a line one pixel wide, where
+// (`vx`, `vy`) is the offset of the center of the first pixel from the start
+// of the line, and (`dx`, `dy`) the offset of its end.
+void _lineCoverage(
+    float vx, float vy, float dx, float dy, float inverseLength2, int n,
+    Uint8* coverage
+)
+{
+#ifdef __SSE2__
+    __m128 vxs = _mm_set1_ps(vx);
+    __m128 y = _mm_set1_ps(vy);
+    __m128 dxs = _mm_set1_ps(dx);
+    __m128 dys = _mm_set1_ps(dy);
+    __m128 inverse = _mm_set1_ps(inverseLength2);
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1);
+
+    for (int i = 0; i < n; i += 4)
+    {
+        __m128 x = _mm_add_ps(vxs, _pixelOffsets(i));
+
+        // Projects the pixel centers on the line, clamped to its ends.
+        __m128 dot = _mm_add_ps(_mm_mul_ps(x, dxs), _mm_mul_ps(y, dys));
+        __m128 t = _mm_mul_ps(dot, inverse);
+        t = _mm_min_ps(_mm_max_ps(t, zero), one);
+
+        __m128 qx = _mm_sub_ps(x, _mm_mul_ps(t, dxs));
+        __m128 qy = _mm_sub_ps(y, _mm_mul_ps(t, dys));
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy));
+
+        _storeCoverage(_mm_sub_ps(one, _mm_sqrt_ps(d2)), coverage + i);
+    }
+#else
+    for (int i = 0; i < n; i++)
+    {
+        float x = vx + i;
+        float t = clamp((x * dx + vy * dy) * inverseLength2, 0.0f, 1.0f);
+        float qx = x - t * dx;
+        float qy = vy - t * dy;
+        float d = sqrt(qx * qx + qy * qy);
+
+        coverage[i] = nearbyint(clamp(1 - d, 0.0f, 1.0f) * 255);
+    }
+#endif
+}
+
+#ifdef __SSE2__
+
+// Divides 16 bit lanes by 255, rounding to the nearest.
+__m128i _div255(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Blends two pixels, with 16 bit channels.
+__m128i _blend(__m128i pixels, __m128i color, __m128i coverage)
+{
+    __m128i s = _div255(_mm_mullo_epi16(color, coverage));
+
+    // Spreads the alpha of each pixel over its four channels.
+    __m128i sa = _mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+    sa = _mm_shufflehi_epi16(sa, _MM_SHUFFLE(3, 3, 3, 3));
+
+    __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), sa);
+
+    return _mm_add_epi16(s, _div255(_mm_mullo_epi16(pixels, inverse)));
+}
+
+// Returns the offsets of four pixels from pixel `i` on, which are added to the
+// offset of the first pixel for each group of four, rather than stepped, for
+// the coverage to round like the scalar one.
+__m128 _pixelOffsets(int i)
+{
+    return _mm_cvtepi32_ps(_mm_setr_epi32(i, i + 1, i + 2, i + 3));
+}
+
+// Stores four coverages, clamped from 0 to 1, as bytes from 0 to 255. Halves
+// are rounded to even, like `nearbyint` does.
+void _storeCoverage(__m128 coverage, Uint8* out)
+{
+    coverage = _mm_max_ps(coverage, _mm_setzero_ps());
+    coverage = _mm_min_ps(coverage, _mm_set1_ps(1));
+
+    __m128i c = _mm_cvtps_epi32(_mm_mul_ps(coverage, _mm_set1_ps(255)));
+    c = _mm_packs_epi32(c, c);
+    c = _mm_packus_epi16(c, c);
+
+    Uint32 c4 = _mm_cvtsi128_si32(c);
+
+    memcpy(out, &c4, sizeof(c4));
+}
+
+#endif
+
+} // namespace smocc::raster
@@ -0,0 +1,60 @@
+/*
+
+raster.h: Software rasterizer for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#pragma once
+
+#include <SDL.h>
+
+namespace smocc::raster
+{
+
+// Enables the rasterizer, with a transparent framebuffer of given size. While
+// enabled, the `gfx` drawing functions draw into the framebuffer instead of
+// submitting geometry to the renderer.
+void init(int width, int height);
+
+bool isEnabled();
+int getWidth();
+int getHeight();
+
+// Returns the framebuffer pixels, row by row, in premultiplied ARGB.
+const Uint32* getPixels();
+
+// Returns the FNV-1a hash of the framebuffer pixels.
+unsigned long long hash();
+
+// Makes the framebuffer transparent.
+void clear();
+
+// The functions below blend with the given color, not premultiplied, and blend
+// mode. Blend modes other than none and additive are blended as alpha blending.
+// Coordinates are in pixels, with pixel centers at half units.
+void fillRect(int x, int y, int w, int h, SDL_Color c, SDL_BlendMode mode);
+
+// Fills an anti-aliased circle.
+void fillCircle(
+    float x, float y, float radius, SDL_Color c, SDL_BlendMode mode
+);
+
+// Draws an anti-aliased line, one pixel wide, between the given points.
+void drawLine(
+    float x1, float y1, float x2, float y2, SDL_Color c, SDL_BlendMode mode
+);
+
+// Returns true if anything was drawn since the last upload or clear.
+bool isDirty();
+
+// Copies the part of the framebuffer drawn since the last upload into a
+// streaming texture, and makes it transparent again. The part is stored in
+// `rect`, in both texture and output coordinates. The texture has premultiplied
+// alpha blending, and its content is only valid until the next upload.
+SDL_Texture* upload(SDL_Rect* rect);
+
+} // namespace smocc::raster
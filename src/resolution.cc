@@ -0,0 +1,254 @@
+/*
+
+resolution.cc: Dynamic playfield resolution for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "gfx.h"
+#include "pacer.h"
+#include "raster.h"
+#include "resolution.h"
+#include "smocc.h"
+
+using namespace std;
+
+namespace smocc::resolution
+{
+
+// Scales the playfield steps through, from full resolution down.
+const double _SCALES[] = {1.0, 0.85, 0.7, 0.5};
+const int _SCALE_COUNT = sizeof(_SCALES) / sizeof(_SCALES[0]);
+
+// Fractions of the budget a frame must be over to step down, and under to step
+// up. The gap between them keeps the scale from going back and forth.
+const double _STEP_DOWN_LOAD = 0.9;
+const double _STEP_UP_LOAD = 0.6;
+
+// Consecutive frames over or under the budget it takes to step down or up.
+// Stepping up waits longer, as it's what costs frame time.
+const int _STEP_DOWN_FRAMES = 15;
+const int _STEP_UP_FRAMES = 60;
+
+// Frames after a step during which no other step is taken, for the frame
+// times to reflect the new scale.
+const int _COOLDOWN_FRAMES = 30;
+
+// Weight of the last frame in the smoothed frame time.
+const double _SMOOTHING = 0.2;
+
+bool _enabled = false;
+int _scaleIndex = 0;
+double _busyMilliseconds = 0;
+int _overFrames = 0;
+int _underFrames = 0;
+int _cooldownFrames = 0;
+
+SDL_Texture* _playfield = NULL;
+int _playfieldWidth;
+int _playfieldHeight;
+bool _redirected = false;
+
+double _budget();
+double _refreshMilliseconds();
+void _step(int direction);
+SDL_Texture* _getPlayfield(int w, int h);
+
+void enable()
+{
+    _enabled = true;
+}
+
+bool isEnabled()
+{
+    return _enabled;
+}
+
+double getScale()
+{
+    return _SCALES[_scaleIndex];
+}
+
+void update()
+{
+    if (!_enabled) return;
+
+    double last = smocc::pacer::getStats().lastBusyMilliseconds;
+
+    _busyMilliseconds += (last - _busyMilliseconds) * _SMOOTHING;
+
+    if (_cooldownFrames > 0)
+    {
+        _cooldownFrames--;
+        return;
+    }
+
+    double load = _busyMilliseconds / _budget();
+
+    _overFrames = load > _STEP_DOWN_LOAD ? _overFrames + 1 : 0;
+    _underFrames = load < _STEP_UP_LOAD ? _underFrames + 1 : 0;
+
+    if (_overFrames >= _STEP_DOWN_FRAMES) _step(1);
+    if (_underFrames >= _STEP_UP_FRAMES) _step(-1);
+}
+
+void beginPlayfield()
+{
+    // The software rasterizer draws at full resolution to its own buffer.
+    if (!_enabled || _scaleIndex == 0 || smocc::raster::isEnabled()) return;
+
+    SDL_Renderer* renderer = smocc::getRenderer();
+    int w, h;
+
+    if (SDL_GetRendererOutputSize(renderer, &w, &h))
+    {
+        cerr << "Failed to get renderer output size: " << SDL_GetError()
+             << endl;
+        exit(1);
+    }
+
+    SDL_Texture* playfield = _getPlayfield(w, h);
+
+    gfx::flush();
+
+    if (SDL_SetRenderTarget(renderer, playfield))
+    {
+        cerr << "Failed to set render target: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    float scale = getScale();
+
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+
+    if (SDL_RenderSetScale(renderer, scale, scale))
+    {
+        cerr << "Failed to set render scale: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    _redirected = true;
+}
+
+void endPlayfield()
+{
+    if (!_redirected) return;
+
+    SDL_Renderer* renderer = smocc::getRenderer();
+
+    gfx::flush();
+
+    bool failed = SDL_SetRenderTarget(renderer, NULL);
+
+    failed = failed || SDL_RenderSetScale(renderer, 1, 1);
+
+    if (failed)
+    {
+        cerr << "Failed to reset render target: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    _redirected = false;
+
+    // Only the part of the texture the scaled playfield was drawn to is used.
+    SDL_Rect source = {
+        0, 0, (int)ceil(_playfieldWidth * getScale()),
+        (int)ceil(_playfieldHeight * getScale())
+    };
+
+    SDL_Rect rect = {0, 0, _playfieldWidth, _playfieldHeight};
+
+    gfx::renderTexture(_playfield, &source, &rect);
+}
+
+double _budget()
+{
+    unsigned int frameRate = smocc::pacer::getFrameRate();
+    double budget = frameRate > 0 ? 1000.0 / frameRate : 0;
+
+    // With vsync, frames come no faster than the display refreshes.
+    if (smocc::pacer::isVsyncEnabled())
+        budget = max(budget, _refreshMilliseconds());
+
+    if (budget == 0) return UNPACED_BUDGET_MILLISECONDS;
+
+    return budget;
+}
+
+// Returns the refresh period of the display showing the window, or 0 if it's
+// unknown. It's looked up each time, as the window can change display.
+double _refreshMilliseconds()
+{
+    int display = SDL_GetWindowDisplayIndex(smocc::getWindow());
+    SDL_DisplayMode mode;
+
+    if (display < 0 || SDL_GetCurrentDisplayMode(display, &mode)) return 0;
+    if (mode.refresh_rate <= 0) return 0;
+
+    return 1000.0 / mode.refresh_rate;
+}
+
+void _step(int direction)
+{
+    _scaleIndex = clamp(_scaleIndex + direction, 0, _SCALE_COUNT - 1);
+    _overFrames = 0;
+    _underFrames = 0;
+    _cooldownFrames = _COOLDOWN_FRAMES;
+}
+
+SDL_Texture* _getPlayfield(int w, int h)
+{
+    bool sized = _playfieldWidth == w && _playfieldHeight == h;
+
+    if (_playfield && sized) return _playfield;
+
+    if (_playfield)
+    {
+        gfx::flush();
+        SDL_DestroyTexture(_playfield);
+    }
+
+    // Full size, so that any scale fits, and stepping needs no new texture.
+    _playfield = SDL_CreateTexture(
+        smocc::getRenderer(), SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_TARGET, w, h
+    );
+
+    if (!_playfield)
+    {
+        cerr << "Failed to create playfield texture: " << SDL_GetError()
+             << endl;
+        exit(1);
+    }
+
+    // Drawing with alpha blending onto transparent leaves the colors already
+    // multiplied by alpha.
+    bool failed = SDL_SetTextureBlendMode(
+        _playfield, gfx::premultipliedBlendMode()
+    );
+
+    failed = failed || SDL_SetTextureScaleMode(_playfield, SDL_ScaleModeLinear);
+
+    if (failed)
+    {
+        cerr << "Failed to set up playfield texture: " << SDL_GetError()
+             << endl;
+        exit(1);
+    }
+
+    _playfieldWidth = w;
+    _playfieldHeight = h;
+
+    return _playfield;
+}
+
+} // namespace smocc::resolution
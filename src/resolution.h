@@ -0,0 +1,40 @@
+/*
+
+resolution.h: Dynamic playfield resolution for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#pragma once
+
+namespace smocc::resolution
+{
+
+// Frame time budget when frames aren't paced at a frame rate, or by a display
+// whose refresh rate is known.
+const double UNPACED_BUDGET_MILLISECONDS = 1000.0 / 60;
+
+// Makes the playfield render at a lower resolution while frames take longer
+// than the frame rate allows, and at full resolution again once they're back
+// well within it. The UI always renders at full resolution.
+void enable();
+
+bool isEnabled();
+
+// Returns the scale the playfield is currently rendered at, from 0 to 1.
+double getScale();
+
+// Picks the scale for the frame from the recent frame times. To be called
+// once per frame, before anything is drawn.
+void update();
+
+// Redirects drawing to the offscreen playfield, at the current scale.
+void beginPlayfield();
+
+// Draws the offscreen playfield to the screen, stretched to its full size.
+void endPlayfield();
+
+} // namespace smocc::resolution
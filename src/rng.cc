@@ -11,26 +11,145 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 #include <cmath>
 #include <random>
 
+#include "rng.h"
+
 using namespace std;
 
 namespace smocc::rng
 {
 
-random_device _rd;
-mt19937 _gen(_rd());
-uniform_real_distribution<double> _rng(0.0, 1.0);
+// State of a xoshiro256+ generator, see https://prng.di.unimi.it. It is much
+// smaller and faster than mt19937, and good enough for floating point numbers.
+struct Generator
+{
+    unsigned long long s[4];
+};
+
+// Jump polynomial advancing a generator by 2^128 steps, so that each stream
+// starts from a point of the sequence that no other stream will ever reach.
+const unsigned long long _JUMP[] = {
+    0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa,
+    0x39abdc4529b1661c
+};
+
+unsigned long long _seed;
+Generator _streams[STREAMS_COUNT];
+
+unsigned long long _next(Generator& generator);
+void _jump(Generator& generator);
+unsigned long long _splitMix(unsigned long long* state);
+unsigned long long _rotateLeft(unsigned long long x, int k);
+double _toUnitInterval(unsigned long long bits);
+
+void init()
+{
+    random_device rd;
+
+    seed((unsigned long long)rd() << 32 | rd());
+}
 
-double roll()
+void seed(unsigned long long seed)
 {
-    return _rng(_gen);
+    _seed = seed;
+
+    // The state of the generator is initialized by SplitMix64, as recommended
+    // by the authors, because it shouldn't be all zeros or poorly mixed.
+    unsigned long long splitMixState = seed;
+    Generator generator;
+
+    for (int i = 0; i < 4; i++)
+        generator.s[i] = _splitMix(&splitMixState);
+
+    for (unsigned int i = 0; i < STREAMS_COUNT; i++)
+    {
+        _streams[i] = generator;
+        _jump(generator);
+    }
 }
 
-int rollInt(int min, int max)
+unsigned long long getSeed()
 {
-    double r = roll();
+    return _seed;
+}
+
+double roll(Stream stream)
+{
+    return _toUnitInterval(_next(_streams[stream]));
+}
+
+int rollInt(Stream stream, int min, int max)
+{
+    double r = roll(stream);
     int range = max - min + 1;
     int i = min + (int)(r * range);
     return std::min(i, max);
 }
 
-} // namespace smocc::rng
\ No newline at end of file
+void fill(Stream stream, double* rolls, unsigned int count)
+{
+    // Works on a local copy of the state, which the compiler can keep in
+    // registers for the whole loop.
+    Generator generator = _streams[stream];
+
+    for (unsigned int i = 0; i < count; i++)
+        rolls[i] = _toUnitInterval(_next(generator));
+
+    _streams[stream] = generator;
+}
+
+unsigned long long _next(Generator& generator)
+{
+    unsigned long long* s = generator.s;
+    unsigned long long result = s[0] + s[3];
+    unsigned long long t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = _rotateLeft(s[3], 45);
+
+    return result;
+}
+
+void _jump(Generator& generator)
+{
+    Generator jumped = {{0, 0, 0, 0}};
+
+    for (unsigned long long jump : _JUMP)
+        for (int b = 0; b < 64; b++)
+        {
+            if (jump & 1ull << b)
+                for (int i = 0; i < 4; i++)
+                    jumped.s[i] ^= generator.s[i];
+
+            _next(generator);
+        }
+
+    generator = jumped;
+}
+
+unsigned long long _splitMix(unsigned long long* state)
+{
+    unsigned long long z = (*state += 0x9e3779b97f4a7c15);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+
+    return z ^ (z >> 31);
+}
+
+unsigned long long _rotateLeft(unsigned long long x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+double _toUnitInterval(unsigned long long bits)
+{
+    // The upper 53 bits are the best ones of xoshiro256+, and are exactly as
+    // many as the mantissa of a double can hold.
+    return (bits >> 11) * 0x1.0p-53;
+}
+
+} // namespace smocc::rng
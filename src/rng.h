@@ -8,12 +8,37 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 
 */
 
+#pragma once
+
 namespace smocc::rng
 {
 
-// Rolls a random number between 0 and 1.
-double roll();
+// Independent random number streams, one for each subsystem, so that the
+// numbers drawn by one subsystem don't depend on how many the others drew.
+enum Stream
+{
+    ENEMIES,
+    BUFFS,
+    BOTS
+};
+
+const unsigned int STREAMS_COUNT = 3;
+
+// Seeds all the streams with a random seed.
+void init();
+
+// Seeds all the streams, making the numbers they produce reproducible.
+void seed(unsigned long long seed);
+
+unsigned long long getSeed();
+
+// Rolls a random number between 0 and 1, 1 excluded.
+double roll(Stream stream);
+
+int rollInt(Stream stream, int min, int max);
 
-int rollInt(int min, int max);
+// Rolls `count` random numbers between 0 and 1 into `rolls`, in the same
+// sequence as many consecutive calls to `roll`.
+void fill(Stream stream, double* rolls, unsigned int count);
 
-} // namespace smocc::rng
\ No newline at end of file
+} // namespace smocc::rng
@@ -9,45 +9,79 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 */
 
 #include <SDL.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <iterator>
 
 #include "background.h"
+#include "bench.h"
 #include "bots.h"
 #include "buffs.h"
 #include "bullets.h"
+#include "capture.h"
 #include "enemies.h"
 #include "explosions.h"
 #include "game.h"
+#include "gfx.h"
+#include "headless.h"
+#include "input.h"
+#include "pacer.h"
 #include "player.h"
+#include "profiler.h"
+#include "raster.h"
+#include "resolution.h"
+#include "rng.h"
 #include "smocc.h"
 #include "ui.h"
 #include "ui/buffs.h"
+#include "ui/cached_screen.h"
 #include "ui/game_over.h"
 #include "ui/info.h"
 #include "ui/main_menu.h"
 #include "ui/menu_btn.h"
 #include "ui/score_record.h"
 #include "ui/text.h"
+#include "workers.h"
 
 using namespace std;
 
 int main(int argc, char* argv[])
 {
+#if defined(SMOCC_BENCH)
+    return smocc::bench::main(argc, argv);
+#elif defined(SMOCC_HEADLESS)
+    return smocc::headless::main(argc, argv);
+#else
     return smocc::main(argc, argv);
+#endif
 }
 
 namespace smocc
 {
 
-const int _GAME_LOOP_MINIMUM_FRAME_TIME_MILLISECONDS = 8;
+const int _IDLE_REDRAW_MILLISECONDS = 1000;
 
 SDL_Window* _window;
 SDL_Renderer* _renderer;
 bool _quit = false;
 
+// Whether the loop is waiting for input before drawing the next frame, and
+// what the screens showed in the last frame.
+bool _idle = false;
+unsigned int _lastScreens = 0;
+
 void _init(int, char*[]);
+void _parseArguments(int, char*[]);
+void _enableSoftwareRender();
 void _event(SDL_Event*);
 void _update();
+void _waitForChange();
+bool _changesScreen(SDL_Event*);
+unsigned int _screens();
+void _pollEvents();
+void _present();
 
 int main(int argc, char* argv[])
 {
@@ -56,6 +90,8 @@ int main(int argc, char* argv[])
     while (!_quit)
         _update();
 
+    smocc::capture::stop();
+
     return 0;
 }
 
@@ -69,6 +105,50 @@ SDL_Renderer* getRenderer()
     return _renderer;
 }
 
+void getWorldSize(int* width, int* height)
+{
+    if (_window == nullptr)
+    {
+        *width = WINDOW_WIDTH;
+        *height = WINDOW_HEIGHT;
+        return;
+    }
+
+    SDL_GetWindowSize(_window, width, height);
+}
+
+const GameModule GAME_MODULES[] = {
+    {"input", smocc::input::update},
+    {"player", smocc::player::update},
+    {"enemies", smocc::enemies::update},
+    {"bots", smocc::bots::update},
+    {"bullets", smocc::bullets::update},
+    {"explosions", smocc::explosions::update},
+    {"buffs", smocc::buffs::update},
+};
+
+const unsigned int GAME_MODULES_COUNT = size(GAME_MODULES);
+
+void updateGame()
+{
+    for (unsigned int i = 0; i < GAME_MODULES_COUNT; i++)
+    {
+        const GameModule& module = GAME_MODULES[i];
+
+        smocc::profiler::measure(module.name, module.update);
+    }
+}
+
+void renderGame()
+{
+    smocc::player::render();
+    smocc::enemies::render();
+    smocc::bots::render();
+    smocc::bullets::render();
+    smocc::explosions::render();
+    smocc::buffs::render();
+}
+
 void _init(int argc, char* argv[])
 {
     if (SDL_Init(SDL_INIT_VIDEO))
@@ -87,6 +167,8 @@ void _init(int argc, char* argv[])
         exit(1);
     }
 
+    smocc::profiler::init();
+    smocc::pacer::init();
     smocc::background::init();
     smocc::ui::init();
     smocc::ui::text::init(argc, argv);
@@ -95,47 +177,262 @@ void _init(int argc, char* argv[])
     smocc::ui::game_over::init();
     smocc::ui::score_record::init();
     smocc::ui::buffs::init();
+    smocc::workers::init();
+    smocc::rng::init();
     smocc::game::init();
+    smocc::input::init();
     smocc::player::init();
     smocc::enemies::init();
     smocc::bots::init();
     smocc::bullets::init();
     smocc::explosions::init();
     smocc::buffs::init();
+
+    _parseArguments(argc, argv);
+
+    // Replays start right away, skipping the main menu.
+    if (smocc::input::isReplaying())
+    {
+        smocc::ui::main_menu::hide();
+        smocc::game::begin();
+    }
+}
+
+void _parseArguments(int argc, char* argv[])
+{
+    bool vsync = false;
+    int frameRate = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (!strcmp(argv[i], "--profile-csv") && hasValue)
+        {
+            smocc::profiler::dumpCSV(argv[++i]);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--fps") && hasValue)
+        {
+            frameRate = max(atoi(argv[++i]), 0);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--vsync"))
+        {
+            vsync = true;
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--dynamic-resolution"))
+        {
+            smocc::resolution::enable();
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--software-render"))
+        {
+            _enableSoftwareRender();
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--capture") && hasValue)
+        {
+            smocc::capture::start(argv[++i]);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--record") && hasValue)
+        {
+            smocc::input::record(argv[++i]);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--replay") && hasValue)
+        {
+            smocc::input::replay(argv[++i]);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--seed") && hasValue)
+        {
+            smocc::rng::seed(strtoull(argv[++i], nullptr, 10));
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--tick-rate") && hasValue)
+        {
+            smocc::game::setTickRate(atoi(argv[++i]));
+            continue;
+        }
+
+        cerr << "Ignoring unknown argument: " << argv[i] << endl;
+    }
+
+    // With vsync, the display paces the frames, unless a frame rate is given.
+    if (vsync)
+    {
+        smocc::pacer::enableVsync();
+
+        if (frameRate < 0) frameRate = 0;
+    }
+
+    if (frameRate >= 0) smocc::pacer::setFrameRate(frameRate);
+}
+
+void _enableSoftwareRender()
+{
+    int w, h;
+
+    if (SDL_GetRendererOutputSize(_renderer, &w, &h))
+    {
+        cerr << "Failed to get renderer output size: " << SDL_GetError()
+             << endl;
+        exit(1);
+    }
+
+    smocc::raster::init(w, h);
 }
 
 void _event(SDL_Event* e)
 {
     if (e->type == SDL_QUIT) _quit = true;
+
+    // Some renderers lose the content of render targets, as when the device
+    // is lost, so the cached screens are composed again.
+    bool targetsReset = e->type == SDL_RENDER_TARGETS_RESET;
+
+    if (targetsReset || e->type == SDL_RENDER_DEVICE_RESET)
+        smocc::ui::cached_screen::invalidateAll();
+
+    bool keyDown = e->type == SDL_KEYDOWN && !e->key.repeat;
+
+    if (keyDown && e->key.keysym.sym == SDLK_F3)
+        smocc::profiler::toggleOverlay();
 }
 
 void _update()
 {
+    using smocc::profiler::measure;
+
+    if (_idle) _waitForChange();
+
+    if (_quit) return;
+
+    smocc::pacer::beginFrame();
+    smocc::resolution::update();
+
+    smocc::profiler::beginFrame();
+
     SDL_SetRenderDrawColor(_renderer, 255, 255, 255, 255);
     SDL_RenderClear(_renderer);
 
+    measure("events", _pollEvents);
+    measure("background", smocc::background::update);
+    measure("ui", smocc::ui::update);
+    measure("ui::main_menu", smocc::ui::main_menu::update);
+    measure("ui::info", smocc::ui::info::update);
+    measure("ui::game_over", smocc::ui::game_over::update);
+    measure("ui::score_record", smocc::ui::score_record::update);
+    measure("ui::buffs", smocc::ui::buffs::update);
+    measure("game", smocc::game::update);
+
+    // Game modules reset themselves when updated while no game is running.
+    if (!smocc::game::isRunning()) updateGame();
+
+    while (smocc::game::tick())
+        updateGame();
+
+    // Only the playfield is scaled down when frames run long, as it's where
+    // most of the drawing is, and text and buttons would blur.
+    smocc::resolution::beginPlayfield();
+    measure("render", renderGame);
+    smocc::resolution::endPlayfield();
+
+    smocc::profiler::render();
+
+    measure("present", _present);
+
+    smocc::profiler::endFrame();
+
+    // Without a game running, what is drawn only changes in response to input,
+    // so once a frame leaves the screens as they were, the loop waits for it.
+    // Captures keep a steady frame rate regardless.
+    unsigned int screens = _screens();
+    bool running = smocc::game::isRunning();
+    bool overlay = smocc::profiler::isOverlayVisible();
+    bool capturing = smocc::capture::isCapturing();
+
+    _idle = !running && !overlay && !capturing && screens == _lastScreens;
+    _lastScreens = screens;
+
+    smocc::pacer::endFrame();
+}
+
+void _waitForChange()
+{
+    SDL_Event e;
+
+    // Redraws now and then regardless, in case the window lost its content
+    // without an event telling about it.
+    while (!_quit && SDL_WaitEventTimeout(&e, _IDLE_REDRAW_MILLISECONDS))
+    {
+        _event(&e);
+
+        if (_changesScreen(&e)) return;
+    }
+}
+
+bool _changesScreen(SDL_Event* e)
+{
+    switch (e->type)
+    {
+    case SDL_MOUSEMOTION:
+        return smocc::ui::menu_btn::hoverChanged(e->motion.x, e->motion.y);
+
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+    case SDL_KEYDOWN:
+    case SDL_WINDOWEVENT:
+    case SDL_RENDER_TARGETS_RESET:
+    case SDL_RENDER_DEVICE_RESET:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+// Returns a mask of what the screens show, apart from the game.
+unsigned int _screens()
+{
+    unsigned int screens = 0;
+
+    if (smocc::ui::main_menu::isVisible()) screens |= 1 << 0;
+    if (smocc::ui::info::isVisible()) screens |= 1 << 1;
+    if (smocc::ui::game_over::isVisible()) screens |= 1 << 2;
+    if (smocc::ui::getPointerStyle() == smocc::ui::HAND) screens |= 1 << 3;
+
+    return screens;
+}
+
+void _pollEvents()
+{
     SDL_Event e;
 
     while (!_quit && SDL_PollEvent(&e))
         _event(&e);
+}
 
-    smocc::background::update();
-    smocc::ui::update();
-    smocc::ui::main_menu::update();
-    smocc::ui::info::update();
-    smocc::ui::game_over::update();
-    smocc::ui::score_record::update();
-    smocc::ui::buffs::update();
-    smocc::game::update();
-    smocc::player::update();
-    smocc::enemies::update();
-    smocc::bots::update();
-    smocc::bullets::update();
-    smocc::explosions::update();
-    smocc::buffs::update();
+void _present()
+{
+    gfx::flush();
+    smocc::capture::frame();
 
+    // Presenting with vsync waits for the display, which isn't frame work.
+    smocc::pacer::endBusy();
     SDL_RenderPresent(_renderer);
-    SDL_Delay(_GAME_LOOP_MINIMUM_FRAME_TIME_MILLISECONDS);
 }
 
 } // namespace smocc
\ No newline at end of file
@@ -21,4 +21,24 @@ int main(int, char**);
 SDL_Window* getWindow();
 SDL_Renderer* getRenderer();
 
+// Gets the size of the area where the game takes place. Without a window, as
+// in the headless build, this is a virtual area of the default window size.
+void getWorldSize(int* width, int* height);
+
+struct GameModule
+{
+    const char* name;
+    void (*update)();
+};
+
+// Game modules, in the order they're updated in each tick.
+extern const GameModule GAME_MODULES[];
+extern const unsigned int GAME_MODULES_COUNT;
+
+// Runs a simulation tick of all the game modules.
+void updateGame();
+
+// Draws all the game modules, interpolating between the last two ticks.
+void renderGame();
+
 } // namespace smocc
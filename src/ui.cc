@@ -56,6 +56,8 @@ void update()
 
     if (_pointerStyle == ARROW) SDL_SetCursor(_arrowCursor);
     if (_pointerStyle == HAND) SDL_SetCursor(_handCursor);
+
+    menu_btn::update();
 }
 
 void setPointerStyle(PointerStyle style)
@@ -63,6 +65,11 @@ void setPointerStyle(PointerStyle style)
     _pointerStyle = style;
 }
 
+PointerStyle getPointerStyle()
+{
+    return _pointerStyle;
+}
+
 SDL_Rect rect()
 {
     return _uiRect;
@@ -24,6 +24,7 @@ enum PointerStyle
 void init();
 void update();
 void setPointerStyle(PointerStyle);
+PointerStyle getPointerStyle();
 SDL_Rect rect();
 
 } // namespace smocc::ui
@@ -0,0 +1,158 @@
+/*
+
+ui/cached_screen.cc: Cached composition of static UI screens for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#include <SDL.h>
+#include <cassert>
+#include <iostream>
+
+#include "../gfx.h"
+#include "../raster.h"
+#include "../smocc.h"
+#include "../ui.h"
+#include "cached_screen.h"
+
+using namespace std;
+
+namespace smocc::ui::cached_screen
+{
+
+// Starts from 1, so that screens initialized to zero are composed.
+unsigned int _generation = 1;
+
+// Screen whose texture drawing goes to, if any.
+CachedScreen* _composing = NULL;
+
+void _getOutputSize(int* w, int* h);
+bool _hasSize(CachedScreen* screen, int w, int h);
+bool _isComposed(CachedScreen* screen, int w, int h);
+
+bool begin(CachedScreen* screen)
+{
+    // Shapes drawn in software go to the framebuffer, not to render targets.
+    if (smocc::raster::isEnabled()) return true;
+
+    int w, h;
+
+    _getOutputSize(&w, &h);
+
+    if (_isComposed(screen, w, h)) return false;
+
+    SDL_Renderer* renderer = smocc::getRenderer();
+
+    gfx::flush();
+
+    if (screen->texture && !_hasSize(screen, w, h))
+    {
+        SDL_DestroyTexture(screen->texture);
+        screen->texture = NULL;
+    }
+
+    if (!screen->texture)
+    {
+        screen->texture = SDL_CreateTexture(
+            renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h
+        );
+
+        if (!screen->texture)
+        {
+            cerr << "Failed to create screen texture: " << SDL_GetError()
+                 << endl;
+            exit(1);
+        }
+
+        // Drawing with alpha blending onto transparent leaves the colors
+        // already multiplied by alpha.
+        SDL_BlendMode blendMode = gfx::premultipliedBlendMode();
+
+        if (SDL_SetTextureBlendMode(screen->texture, blendMode))
+        {
+            cerr << "Failed to set screen texture blend mode: "
+                 << SDL_GetError() << endl;
+            exit(1);
+        }
+    }
+
+    if (SDL_SetRenderTarget(renderer, screen->texture))
+    {
+        cerr << "Failed to set render target: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+
+    screen->uiRect = ui::rect();
+    screen->generation = _generation;
+    _composing = screen;
+
+    return true;
+}
+
+void end(CachedScreen* screen)
+{
+    if (!_composing) return;
+
+    // Screens are composed one at a time, each ended before the next begins.
+    assert(screen == _composing);
+
+    gfx::flush();
+
+    if (SDL_SetRenderTarget(smocc::getRenderer(), NULL))
+    {
+        cerr << "Failed to reset render target: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    _composing = NULL;
+}
+
+void draw(CachedScreen* screen)
+{
+    if (smocc::raster::isEnabled()) return;
+
+    SDL_Rect rect = gfx::textureSize(screen->texture);
+
+    gfx::renderTexture(screen->texture, &rect);
+}
+
+void invalidateAll()
+{
+    _generation++;
+}
+
+void _getOutputSize(int* w, int* h)
+{
+    if (SDL_GetRendererOutputSize(smocc::getRenderer(), w, h))
+    {
+        cerr << "Failed to get renderer output size: " << SDL_GetError()
+             << endl;
+        exit(1);
+    }
+}
+
+bool _hasSize(CachedScreen* screen, int w, int h)
+{
+    SDL_Rect size = gfx::textureSize(screen->texture);
+
+    return size.w == w && size.h == h;
+}
+
+bool _isComposed(CachedScreen* screen, int w, int h)
+{
+    if (!screen->texture) return false;
+    if (screen->generation != _generation) return false;
+    if (!_hasSize(screen, w, h)) return false;
+
+    SDL_Rect uiRect = ui::rect();
+
+    return SDL_RectEquals(&uiRect, &screen->uiRect);
+}
+
+} // namespace smocc::ui::cached_screen
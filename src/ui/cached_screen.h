@@ -0,0 +1,41 @@
+/*
+
+ui/cached_screen.h: Cached composition of static UI screens for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#pragma once
+
+#include <SDL.h>
+
+namespace smocc::ui::cached_screen
+{
+
+// The content of a screen that doesn't change from frame to frame, composed
+// once into a texture the size of the window.
+struct CachedScreen
+{
+    SDL_Texture* texture;
+    SDL_Rect uiRect;
+    unsigned int generation;
+};
+
+// Returns true if the screen has to be composed, in which case drawing goes to
+// its texture until `end` is called. Screens are composed again when the UI
+// area changes, or the renderer loses the texture content. With software
+// rendering, screens aren't cached, so this always returns true and drawing
+// goes directly to the window.
+bool begin(CachedScreen* screen);
+void end(CachedScreen* screen);
+
+// Draws the composed screen.
+void draw(CachedScreen* screen);
+
+// Makes all the screens be composed again, as when render targets are reset.
+void invalidateAll();
+
+} // namespace smocc::ui::cached_screen
@@ -12,6 +12,7 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 #include "../game.h"
 #include "../gfx.h"
 #include "../ui.h"
+#include "cached_screen.h"
 #include "main_menu.h"
 #include "menu_btn.h"
 #include "text.h"
@@ -38,6 +39,12 @@ int _gameOverTextWidth, _gameOverTextHeight;
 
 bool _gameOverVisible;
 
+cached_screen::CachedScreen _screen;
+SDL_Rect _tryAgainBtnRect;
+SDL_Rect _backBtnRect;
+
+void _compose();
+
 void init()
 {
     _gameOverVisible = false;
@@ -78,39 +85,19 @@ void update()
 {
     if (!_gameOverVisible) return;
 
-    SDL_Rect uiRect = ui::rect();
-
-    SDL_Rect gameOverViewRect;
-    gameOverViewRect.w = menu_btn::WIDTH_PIXELS;
-    gameOverViewRect.h = _gameOverViewHeight;
-    gameOverViewRect.x = uiRect.x + (uiRect.w - gameOverViewRect.w) / 2;
-    gameOverViewRect.y = uiRect.y + (uiRect.h - gameOverViewRect.h) / 2;
-
-    SDL_Rect gameOverTextRect;
-    gameOverTextRect.w = _gameOverTextWidth;
-    gameOverTextRect.h = _gameOverTextHeight;
-    gameOverTextRect.x = uiRect.x + (uiRect.w - gameOverTextRect.w) / 2;
-    gameOverTextRect.y = gameOverViewRect.y + _GAME_OVER_TEXT_MARGIN_PIXELS;
-
-    int tryAgainBtnYPosition =
-        gameOverTextRect.y + gameOverTextRect.h + _GAME_OVER_TEXT_MARGIN_PIXELS;
-
-    SDL_Rect tryAgainBtnRect =
-        menu_btn::rect(_tryAgainText, tryAgainBtnYPosition);
-
-    int backToMainMenuBtnYPosition =
-        tryAgainBtnRect.y + tryAgainBtnRect.h + menu_btn::MARGIN_PIXELS;
-
-    SDL_Rect backBtnRect =
-        menu_btn::rect(_backToMainText, backToMainMenuBtnYPosition);
+    if (cached_screen::begin(&_screen))
+    {
+        _compose();
+        cached_screen::end(&_screen);
+    }
 
-    gfx::renderTexture(_gameOverText, &gameOverTextRect);
+    cached_screen::draw(&_screen);
 
-    menu_btn::draw(&tryAgainBtnRect, _tryAgainText, _tryAgainHoverText);
-    menu_btn::draw(&backBtnRect, _backToMainText, _backToMainHoverText);
+    menu_btn::drawHover(&_tryAgainBtnRect, _tryAgainHoverText);
+    menu_btn::drawHover(&_backBtnRect, _backToMainHoverText);
 
-    bool tryAgainBtnHovering = gfx::mouseInRect(&tryAgainBtnRect);
-    bool backToMainMenuBtnHovering = gfx::mouseInRect(&backBtnRect);
+    bool tryAgainBtnHovering = gfx::mouseInRect(&_tryAgainBtnRect);
+    bool backToMainMenuBtnHovering = gfx::mouseInRect(&_backBtnRect);
     Uint32 mouseState = SDL_GetMouseState(NULL, NULL);
     bool pressingLeftMouseButton = mouseState & SDL_BUTTON(SDL_BUTTON_LEFT);
     bool hovering = tryAgainBtnHovering || backToMainMenuBtnHovering;
@@ -134,4 +121,36 @@ void update()
     }
 }
 
+void _compose()
+{
+    SDL_Rect uiRect = ui::rect();
+
+    SDL_Rect gameOverViewRect;
+    gameOverViewRect.w = menu_btn::WIDTH_PIXELS;
+    gameOverViewRect.h = _gameOverViewHeight;
+    gameOverViewRect.x = uiRect.x + (uiRect.w - gameOverViewRect.w) / 2;
+    gameOverViewRect.y = uiRect.y + (uiRect.h - gameOverViewRect.h) / 2;
+
+    SDL_Rect gameOverTextRect;
+    gameOverTextRect.w = _gameOverTextWidth;
+    gameOverTextRect.h = _gameOverTextHeight;
+    gameOverTextRect.x = uiRect.x + (uiRect.w - gameOverTextRect.w) / 2;
+    gameOverTextRect.y = gameOverViewRect.y + _GAME_OVER_TEXT_MARGIN_PIXELS;
+
+    int tryAgainBtnYPosition =
+        gameOverTextRect.y + gameOverTextRect.h + _GAME_OVER_TEXT_MARGIN_PIXELS;
+
+    _tryAgainBtnRect = menu_btn::rect(_tryAgainText, tryAgainBtnYPosition);
+
+    int backToMainMenuBtnYPosition =
+        _tryAgainBtnRect.y + _tryAgainBtnRect.h + menu_btn::MARGIN_PIXELS;
+
+    _backBtnRect = menu_btn::rect(_backToMainText, backToMainMenuBtnYPosition);
+
+    gfx::renderTexture(_gameOverText, &gameOverTextRect);
+
+    menu_btn::drawBase(&_tryAgainBtnRect, _tryAgainText);
+    menu_btn::drawBase(&_backBtnRect, _backToMainText);
+}
+
 } // namespace smocc::ui::game_over
\ No newline at end of file
@@ -15,6 +15,7 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 #include "../colors.h"
 #include "../gfx.h"
 #include "../ui.h"
+#include "cached_screen.h"
 #include "info.h"
 #include "main_menu.h"
 #include "menu_btn.h"
@@ -44,6 +45,11 @@ vector<unsigned int> _lineHeights;
 SDL_Texture* _btnText;
 SDL_Texture* _btnTextHover;
 
+cached_screen::CachedScreen _screen;
+SDL_Rect _btnRect;
+
+void _compose();
+
 void init()
 {
     _infoVisible = false;
@@ -99,10 +105,43 @@ void show()
     _infoVisible = true;
 }
 
+bool isVisible()
+{
+    return _infoVisible;
+}
+
 void update()
 {
     if (!_infoVisible) return;
 
+    if (cached_screen::begin(&_screen))
+    {
+        _compose();
+        cached_screen::end(&_screen);
+    }
+
+    cached_screen::draw(&_screen);
+
+    menu_btn::drawHover(&_btnRect, _btnTextHover);
+
+    Uint32 mouseState = SDL_GetMouseState(NULL, NULL);
+    bool pressingLeftMouseKey = mouseState & SDL_BUTTON(SDL_BUTTON_LEFT);
+
+    bool hoveringBtn = gfx::mouseInRect(&_btnRect);
+    bool clickingBtn = hoveringBtn && pressingLeftMouseKey;
+
+    ui::setPointerStyle(hoveringBtn ? HAND : ARROW);
+
+    if (clickingBtn)
+    {
+        ui::setPointerStyle(ARROW);
+        _infoVisible = false;
+        main_menu::show();
+    }
+}
+
+void _compose()
+{
     SDL_Rect uiRect = ui::rect();
 
     unsigned int viewX = uiRect.x + (uiRect.w - _viewWidth) / 2;
@@ -127,29 +166,12 @@ void update()
         }
     }
 
-    SDL_Rect btnRect;
-
-    btnRect.w = _buttonWidth;
-    btnRect.h = _buttonHeight;
-    btnRect.x = viewX + _viewWidth - _buttonWidth;
-    btnRect.y = viewY + _contentHeight;
-
-    menu_btn::draw(&btnRect, _btnText, _btnTextHover);
-
-    Uint32 mouseState = SDL_GetMouseState(NULL, NULL);
-    bool pressingLeftMouseKey = mouseState & SDL_BUTTON(SDL_BUTTON_LEFT);
-
-    bool hoveringBtn = gfx::mouseInRect(&btnRect);
-    bool clickingBtn = hoveringBtn && pressingLeftMouseKey;
+    _btnRect.w = _buttonWidth;
+    _btnRect.h = _buttonHeight;
+    _btnRect.x = viewX + _viewWidth - _buttonWidth;
+    _btnRect.y = viewY + _contentHeight;
 
-    ui::setPointerStyle(hoveringBtn ? HAND : ARROW);
-
-    if (clickingBtn)
-    {
-        ui::setPointerStyle(ARROW);
-        _infoVisible = false;
-        main_menu::show();
-    }
+    menu_btn::drawBase(&_btnRect, _btnText);
 }
 
 } // namespace smocc::ui::info
@@ -15,6 +15,7 @@ namespace smocc::ui::info
 
 void init();
 void show();
+bool isVisible();
 void update();
 
 } // namespace smocc::ui::info
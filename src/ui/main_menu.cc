@@ -4,6 +4,7 @@
 #include "../game.h"
 #include "../gfx.h"
 #include "../ui.h"
+#include "cached_screen.h"
 #include "info.h"
 #include "menu_btn.h"
 #include "text.h"
@@ -31,6 +32,12 @@ bool _mainMenuVisible;
 
 int _titleWidth, _titleHeight;
 
+cached_screen::CachedScreen _screen;
+SDL_Rect _playBtnRect;
+SDL_Rect _infoBtnRect;
+
+void _compose();
+
 void init()
 {
     _mainMenuVisible = true;
@@ -49,34 +56,33 @@ void show()
     _mainMenuVisible = true;
 }
 
-void update()
+void hide()
 {
-    if (!_mainMenuVisible) return;
-
-    SDL_Rect uiRect = ui::rect();
-
-    SDL_Rect titleRect;
-    titleRect.w = _titleWidth;
-    titleRect.h = _titleHeight;
-    titleRect.x = uiRect.x + (uiRect.w - titleRect.w) / 2;
-    titleRect.y = uiRect.y + _TITLE_MARGINS_PIXELS;
-
-    int playBtnYPosition = titleRect.y + titleRect.h + _TITLE_MARGINS_PIXELS;
+    _mainMenuVisible = false;
+}
 
-    SDL_Rect playBtnRect = menu_btn::rect(_playText, playBtnYPosition);
+bool isVisible()
+{
+    return _mainMenuVisible;
+}
 
-    int infoBtnYPosition =
-        playBtnRect.y + playBtnRect.h + menu_btn::MARGIN_PIXELS;
+void update()
+{
+    if (!_mainMenuVisible) return;
 
-    SDL_Rect infoBtnRect = menu_btn::rect(_infoText, infoBtnYPosition);
+    if (cached_screen::begin(&_screen))
+    {
+        _compose();
+        cached_screen::end(&_screen);
+    }
 
-    gfx::renderTexture(_title, &titleRect);
+    cached_screen::draw(&_screen);
 
-    menu_btn::draw(&playBtnRect, _playText, _playHoverText);
-    menu_btn::draw(&infoBtnRect, _infoText, _infoHoverText);
+    menu_btn::drawHover(&_playBtnRect, _playHoverText);
+    menu_btn::drawHover(&_infoBtnRect, _infoHoverText);
 
-    bool playBtnHovering = gfx::mouseInRect(&playBtnRect);
-    bool infoBtnHovering = gfx::mouseInRect(&infoBtnRect);
+    bool playBtnHovering = gfx::mouseInRect(&_playBtnRect);
+    bool infoBtnHovering = gfx::mouseInRect(&_infoBtnRect);
     Uint32 mouseState = SDL_GetMouseState(NULL, NULL);
     bool pressingLeftMouseButton = mouseState & SDL_BUTTON(SDL_BUTTON_LEFT);
     bool hovering = playBtnHovering || infoBtnHovering;
@@ -98,4 +104,29 @@ void update()
     }
 }
 
+void _compose()
+{
+    SDL_Rect uiRect = ui::rect();
+
+    SDL_Rect titleRect;
+    titleRect.w = _titleWidth;
+    titleRect.h = _titleHeight;
+    titleRect.x = uiRect.x + (uiRect.w - titleRect.w) / 2;
+    titleRect.y = uiRect.y + _TITLE_MARGINS_PIXELS;
+
+    int playBtnYPosition = titleRect.y + titleRect.h + _TITLE_MARGINS_PIXELS;
+
+    _playBtnRect = menu_btn::rect(_playText, playBtnYPosition);
+
+    int infoBtnYPosition =
+        _playBtnRect.y + _playBtnRect.h + menu_btn::MARGIN_PIXELS;
+
+    _infoBtnRect = menu_btn::rect(_infoText, infoBtnYPosition);
+
+    gfx::renderTexture(_title, &titleRect);
+
+    menu_btn::drawBase(&_playBtnRect, _playText);
+    menu_btn::drawBase(&_infoBtnRect, _infoText);
+}
+
 } // namespace smocc::ui::main_menu
\ No newline at end of file
@@ -15,6 +15,8 @@ namespace smocc::ui::main_menu
 
 void init();
 void show();
+void hide();
+bool isVisible();
 void update();
 
 } // namespace smocc::ui::main_menu
@@ -8,20 +8,34 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 
 */
 
+#include <vector>
+
 #include "menu_btn.h"
 #include "../colors.h"
 #include "../gfx.h"
 #include "../smocc.h"
 #include "../ui.h"
 
+using namespace std;
+
 namespace smocc::ui::menu_btn
 {
 
+struct DrawnButton
+{
+    SDL_Rect rect;
+    bool hover;
+};
+
 SDL_Color _FG_COLOR = SMOCC_FOREGROUND_COLOR;
 SDL_Color _BORDER_COLOR = {
     _FG_COLOR.r, _FG_COLOR.g, _FG_COLOR.b, BORDER_OPACITY
 };
 
+vector<DrawnButton> _drawnButtons;
+
+SDL_Rect _textRect(SDL_Rect* rect, SDL_Texture* text);
+
 SDL_Rect rect(SDL_Texture* text, int yPosition)
 {
     SDL_Rect uiRect = ui::rect();
@@ -35,32 +49,60 @@ SDL_Rect rect(SDL_Texture* text, int yPosition)
     return rect;
 }
 
-void draw(SDL_Rect* rect, SDL_Texture* text, SDL_Texture* textHover)
+void drawBase(SDL_Rect* rect, SDL_Texture* text)
 {
-    SDL_Renderer* renderer = smocc::getRenderer();
+    gfx::setDrawColor(&_BORDER_COLOR);
+    gfx::setDrawBlendMode(SDL_BLENDMODE_BLEND);
+    gfx::drawRect(rect);
+
+    SDL_Rect textRect = _textRect(rect, text);
 
+    gfx::renderTexture(text, &textRect);
+}
+
+void drawHover(SDL_Rect* rect, SDL_Texture* textHover)
+{
     bool hover = gfx::mouseInRect(rect);
 
-    SDL_Rect textRect = gfx::textureSize(text);
+    _drawnButtons.push_back({*rect, hover});
 
-    textRect.x = rect->x + (rect->w - textRect.w) / 2;
-    textRect.y = rect->y + (rect->h - textRect.h) / 2;
+    if (!hover) return;
 
-    gfx::setDrawColor(&_BORDER_COLOR);
+    // The opaque fill covers the base of the button.
+    gfx::setDrawColor(&_FG_COLOR);
     gfx::setDrawBlendMode(SDL_BLENDMODE_BLEND);
-    gfx::drawRect(rect);
+    gfx::fillRect(rect);
 
-    if (!hover)
-    {
-        gfx::renderTexture(text, &textRect);
-    }
+    SDL_Rect textRect = _textRect(rect, textHover);
+
+    gfx::renderTexture(textHover, &textRect);
+}
 
-    if (hover)
+void update()
+{
+    _drawnButtons.clear();
+}
+
+bool hoverChanged(int mouseX, int mouseY)
+{
+    for (DrawnButton& button : _drawnButtons)
     {
-        gfx::setDrawColor(&_FG_COLOR);
-        gfx::fillRect(rect);
-        gfx::renderTexture(textHover, &textRect);
+        bool hover = gfx::pointInRect(mouseX, mouseY, &button.rect);
+
+        if (hover != button.hover) return true;
     }
+
+    return false;
+}
+
+SDL_Rect _textRect(SDL_Rect* rect, SDL_Texture* text)
+{
+    SDL_Rect textRect = gfx::textureSize(text);
+
+    textRect.x = rect->x + (rect->w - textRect.w) / 2;
+    textRect.y = rect->y + (rect->h - textRect.h) / 2;
+
+    return textRect;
 }
 
 } // namespace smocc::ui::menu_btn
@@ -21,6 +21,19 @@ const unsigned int MARGIN_PIXELS = 6;
 const unsigned int BORDER_OPACITY = 25;
 
 SDL_Rect rect(SDL_Texture* text, int yPosition);
-void draw(SDL_Rect* rect, SDL_Texture* text, SDL_Texture* textHover);
+
+// Draws the border and text of a button, which can be cached, as they look the
+// same whether the button is hovered or not.
+void drawBase(SDL_Rect* rect, SDL_Texture* text);
+
+// Draws the button as hovered over its base, if the mouse is on it.
+void drawHover(SDL_Rect* rect, SDL_Texture* textHover);
+
+// Forgets the buttons drawn in the previous frame.
+void update();
+
+// Returns true if the mouse at the given position would hover a different set
+// of buttons than it did when they were last drawn.
+bool hoverChanged(int mouseX, int mouseY);
 
 } // namespace smocc::ui::menu_btn
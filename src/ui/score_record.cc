@@ -1,3 +1,5 @@
+#include <string>
+
 #include "../game.h"
 #include "../gfx.h"
 #include "../ui.h"
@@ -6,6 +8,8 @@
 #include "score_record.h"
 #include "text.h"
 
+using namespace std;
+
 namespace smocc::ui::score_record
 {
 
@@ -32,15 +36,17 @@ void update()
     unsigned int score = game::getScore();
     unsigned int record = game::getRecord();
 
-    SDL_Texture* _scoreNumber = ui::text::get(score);
-    SDL_Texture* _recordNumber = ui::text::get(record);
+    // Numbers are drawn from glyphs, as a texture for each of them would pile
+    // up over a game.
+    string scoreNumber = to_string(score);
+    string recordNumber = to_string(record);
 
     SDL_Rect uiRect = ui::rect();
 
     int scoreTextWidth = gfx::textureWidth(_scoreText);
     int recordTextWidth = gfx::textureWidth(_recordText);
-    int scoreNumberWidth = gfx::textureWidth(_scoreNumber);
-    int recordNumberWidth = gfx::textureWidth(_recordNumber);
+    int scoreNumberWidth = ui::text::size(scoreNumber.c_str()).w;
+    int recordNumberWidth = ui::text::size(recordNumber.c_str()).w;
 
     int scoreAndRecordWidth = 0;
     scoreAndRecordWidth += scoreTextWidth + scoreNumberWidth;
@@ -51,7 +57,7 @@ void update()
     scoreTextRect.x = uiRect.x + (uiRect.w - scoreAndRecordWidth) / 2;
     scoreTextRect.y = uiRect.y;
 
-    SDL_Rect scoreNumberRect = gfx::textureSize(_scoreNumber);
+    SDL_Rect scoreNumberRect = ui::text::size(scoreNumber.c_str());
     scoreNumberRect.x = scoreTextRect.x + scoreTextRect.w;
     scoreNumberRect.y = uiRect.y;
 
@@ -60,14 +66,17 @@ void update()
         scoreNumberRect.x + scoreNumberRect.w + _TEXT_MARGIN_PIXELS;
     recordTextRect.y = uiRect.y;
 
-    SDL_Rect recordNumberRect = gfx::textureSize(_recordNumber);
+    SDL_Rect recordNumberRect = ui::text::size(recordNumber.c_str());
     recordNumberRect.x = recordTextRect.x + recordTextRect.w;
     recordNumberRect.y = uiRect.y;
 
+    int scoreX = scoreNumberRect.x;
+    int recordX = recordNumberRect.x;
+
     gfx::renderTexture(_scoreText, &scoreTextRect);
-    gfx::renderTexture(_scoreNumber, &scoreNumberRect);
+    ui::text::draw(scoreNumber.c_str(), scoreX, scoreNumberRect.y);
     gfx::renderTexture(_recordText, &recordTextRect);
-    gfx::renderTexture(_recordNumber, &recordNumberRect);
+    ui::text::draw(recordNumber.c_str(), recordX, recordNumberRect.y);
 }
 
 } // namespace smocc::ui::score_record
\ No newline at end of file
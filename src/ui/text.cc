@@ -8,8 +8,10 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 
 */
 
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
+#include <string>
 #include <unordered_map>
 
 #include <SDL.h>
@@ -17,6 +19,7 @@ This file is part of SMOCC, licensed under GNU General Public License 3.0.
 
 #include "../colors.h"
 #include "../gfx.h"
+#include "../smocc.h"
 #include "text.h"
 
 using namespace std;
@@ -28,21 +31,40 @@ namespace smocc::ui::text
 const char* _REGULAR_FONT_RELATIVE_PATH = "inconsolata-lgc/regular.ttf";
 const char* _BOLD_FONT_RELATIVE_PATH = "inconsolata-lgc/bold.ttf";
 
+// Glyph atlases hold the printable ASCII characters, in rows of 16. Other
+// characters are drawn as the replacement character.
+const char _FIRST_GLYPH = ' ';
+const char _LAST_GLYPH = '~';
+const char _REPLACEMENT_GLYPH = '?';
+const int _GLYPHS_COUNT = _LAST_GLYPH - _FIRST_GLYPH + 1;
+const int _ATLAS_COLUMNS = 16;
+
 fs::path _programDir;
 fs::path _regularFontPath;
 fs::path _boldFontPath;
 
 SDL_Color _FG_COLOR = SMOCC_FOREGROUND_COLOR;
+SDL_Color _WHITE = {255, 255, 255, 255};
+
+// Texts rendered by `get`, by a key made of their properties and string.
+// Callers keep the textures, so they're never destroyed.
+unordered_map<string, SDL_Texture*> _textCache;
 
-typedef unordered_map<string, SDL_Texture*> _textMemoL1;
-typedef unordered_map<unsigned int, _textMemoL1> _textMemoL2;
-typedef unordered_map<unsigned long, _textMemoL2> _textMemoL3;
-unordered_map<int, _textMemoL3> _textMemo;
+struct GlyphAtlas
+{
+    SDL_Texture* texture;
+    SDL_Rect glyphs[_GLYPHS_COUNT];
+};
+
+typedef unordered_map<int, GlyphAtlas> _atlasMemoL1;
+unordered_map<unsigned int, _atlasMemoL1> _atlasMemo;
 
 typedef unordered_map<int, TTF_Font*> _fontMemoL1;
 unordered_map<unsigned int, _fontMemoL1> _fontMemo;
 
 TTF_Font* _getFont(FontStyle style, unsigned int size);
+GlyphAtlas* _getAtlas(FontStyle style, unsigned int size);
+SDL_Rect* _getGlyph(GlyphAtlas* atlas, char c);
 
 unsigned long _colorToInt(SDL_Color color)
 {
@@ -64,20 +86,15 @@ void init(int argc, char* argv[])
 
 SDL_Texture* get(const char* str, unsigned int size, SDL_Color c, FontStyle st)
 {
-    auto k1 = static_cast<int>(st);
-    auto k2 = _colorToInt(c);
-    auto k3 = size;
-    auto k4 = string(str);
+    string key = to_string(st) + ' ' + to_string(size) + ' ';
+    key += to_string(_colorToInt(c)) + ' ' + str;
 
-    if (!_textMemo.contains(k1)) _textMemo[k1] = _textMemoL3();
-    if (!_textMemo[k1].contains(k2)) _textMemo[k1][k2] = _textMemoL2();
-    if (!_textMemo[k1][k2].contains(k3)) _textMemo[k1][k2][k3] = _textMemoL1();
-    if (_textMemo[k1][k2][k3].contains(k4)) return _textMemo[k1][k2][k3][k4];
+    if (_textCache.contains(key)) return _textCache[key];
 
     TTF_Font* font = _getFont(st, size);
     SDL_Texture* texture = gfx::text(font, str, c);
 
-    _textMemo[k1][k2][k3][k4] = texture;
+    _textCache[key] = texture;
 
     return texture;
 }
@@ -102,9 +119,57 @@ SDL_Texture* get(const char* str, FontStyle style)
     return get(str, REGULAR_FONT_SIZE_PIXELS, _FG_COLOR, style);
 }
 
-SDL_Texture* get(unsigned int number)
+void draw(
+    const char* str, int x, int y, unsigned int size, SDL_Color c, FontStyle st
+)
+{
+    GlyphAtlas* atlas = _getAtlas(st, size);
+
+    bool failed = SDL_SetTextureColorMod(atlas->texture, c.r, c.g, c.b);
+
+    failed = failed || SDL_SetTextureAlphaMod(atlas->texture, c.a);
+
+    if (failed)
+    {
+        cerr << "Failed to set glyph atlas color: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    for (const char* p = str; *p; p++)
+    {
+        SDL_Rect* glyph = _getGlyph(atlas, *p);
+        SDL_Rect rect = {x, y, glyph->w, glyph->h};
+
+        gfx::renderTexture(atlas->texture, glyph, &rect);
+
+        x += glyph->w;
+    }
+}
+
+void draw(const char* str, int x, int y)
 {
-    return get(to_string(number).c_str());
+    draw(str, x, y, REGULAR_FONT_SIZE_PIXELS, _FG_COLOR, REGULAR);
+}
+
+SDL_Rect size(const char* str, unsigned int size, FontStyle style)
+{
+    GlyphAtlas* atlas = _getAtlas(style, size);
+    SDL_Rect rect = {0, 0, 0, 0};
+
+    for (const char* p = str; *p; p++)
+    {
+        SDL_Rect* glyph = _getGlyph(atlas, *p);
+
+        rect.w += glyph->w;
+        rect.h = max(rect.h, glyph->h);
+    }
+
+    return rect;
+}
+
+SDL_Rect size(const char* str)
+{
+    return size(str, REGULAR_FONT_SIZE_PIXELS, REGULAR);
 }
 
 TTF_Font* _getFont(FontStyle style, unsigned int size)
@@ -127,4 +192,96 @@ TTF_Font* _getFont(FontStyle style, unsigned int size)
     return font;
 }
 
+GlyphAtlas* _getAtlas(FontStyle style, unsigned int size)
+{
+    auto k1 = static_cast<int>(style);
+    auto k2 = size;
+
+    if (!_atlasMemo.contains(k1)) _atlasMemo[k1] = _atlasMemoL1();
+    if (_atlasMemo[k1].contains(k2)) return &_atlasMemo[k1][k2];
+
+    TTF_Font* font = _getFont(style, size);
+    GlyphAtlas& atlas = _atlasMemo[k1][k2];
+
+    // Each glyph is rendered like a string of that one character, so that the
+    // glyphs line up like in the strings rendered by `get`.
+    SDL_Surface* glyphs[_GLYPHS_COUNT];
+    int cellWidth = 0;
+    int cellHeight = 0;
+
+    for (int i = 0; i < _GLYPHS_COUNT; i++)
+    {
+        char str[] = {(char)(_FIRST_GLYPH + i), '\0'};
+
+        glyphs[i] = TTF_RenderText_Solid(font, str, _WHITE);
+
+        if (!glyphs[i])
+        {
+            cerr << "Failed to render glyph: " << TTF_GetError() << endl;
+            exit(1);
+        }
+
+        cellWidth = max(cellWidth, glyphs[i]->w);
+        cellHeight = max(cellHeight, glyphs[i]->h);
+    }
+
+    int rows = (_GLYPHS_COUNT + _ATLAS_COLUMNS - 1) / _ATLAS_COLUMNS;
+
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(
+        0, cellWidth * _ATLAS_COLUMNS, cellHeight * rows, 32,
+        SDL_PIXELFORMAT_ARGB8888
+    );
+
+    if (!surface)
+    {
+        cerr << "Failed to create glyph atlas: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    for (int i = 0; i < _GLYPHS_COUNT; i++)
+    {
+        SDL_Rect& glyph = atlas.glyphs[i];
+        glyph.x = i % _ATLAS_COLUMNS * cellWidth;
+        glyph.y = i / _ATLAS_COLUMNS * cellHeight;
+        glyph.w = glyphs[i]->w;
+        glyph.h = glyphs[i]->h;
+
+        if (SDL_BlitSurface(glyphs[i], NULL, surface, &glyph))
+        {
+            cerr << "Failed to blit glyph: " << SDL_GetError() << endl;
+            exit(1);
+        }
+
+        SDL_FreeSurface(glyphs[i]);
+    }
+
+    SDL_Renderer* renderer = smocc::getRenderer();
+
+    atlas.texture = SDL_CreateTextureFromSurface(renderer, surface);
+
+    if (!atlas.texture)
+    {
+        cerr << "Failed to create glyph atlas texture: " << SDL_GetError()
+             << endl;
+        exit(1);
+    }
+
+    if (SDL_SetTextureBlendMode(atlas.texture, SDL_BLENDMODE_BLEND))
+    {
+        cerr << "Failed to set texture blend mode: " << SDL_GetError() << endl;
+        exit(1);
+    }
+
+    SDL_FreeSurface(surface);
+
+    return &atlas;
+}
+
+SDL_Rect* _getGlyph(GlyphAtlas* atlas, char c)
+{
+    if (c < _FIRST_GLYPH || c > _LAST_GLYPH) c = _REPLACEMENT_GLYPH;
+
+    return &atlas->glyphs[c - _FIRST_GLYPH];
+}
+
 } // namespace smocc::ui::text
@@ -28,12 +28,23 @@ const FontStyle ALL_STYLES[] = {REGULAR, BOLD};
 void init(int argc, char* argv[]);
 
 // Returns a texture for given text and properties. Saves the texture in a cache
-// for future use with the same parameters.
+// for future use with the same parameters. Textures are kept for as long as the
+// game runs, so texts that change often should be drawn with `draw` instead.
 SDL_Texture* get(const char* str, unsigned int size, SDL_Color c, FontStyle st);
 SDL_Texture* get(const char* str);
 SDL_Texture* get(const char* str, unsigned int size);
 SDL_Texture* get(const char* str, SDL_Color color);
 SDL_Texture* get(const char* str, FontStyle style);
-SDL_Texture* get(unsigned int num);
+
+// Draws text one character at a time, from a texture of glyphs rendered once
+// per font style and size, for text that changes often.
+void draw(
+    const char* str, int x, int y, unsigned int size, SDL_Color c, FontStyle st
+);
+void draw(const char* str, int x, int y);
+
+// Returns the size of text drawn with `draw`.
+SDL_Rect size(const char* str, unsigned int size, FontStyle style);
+SDL_Rect size(const char* str);
 
 } // namespace smocc::ui::text
\ No newline at end of file
@@ -0,0 +1,146 @@
+/*
+
+workers.cc: Worker thread pool for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "workers.h"
+
+using namespace std;
+
+namespace smocc::workers
+{
+
+mutex _mutex;
+condition_variable _started;
+condition_variable _finished;
+vector<thread> _threads;
+bool _stopping = false;
+
+// Jobs being run, which threads take indices of one at a time. Workers join a
+// run when it's started, and the caller waits for all of them to leave it.
+void (*_job)(int);
+int _count;
+atomic<int> _next;
+unsigned long long _run = 0;
+unsigned int _busyWorkers = 0;
+
+void _work();
+void _take(void (*job)(int), int count);
+void _stop();
+
+void init()
+{
+    unsigned int cores = thread::hardware_concurrency();
+    unsigned int threads = clamp(cores, 1u, MAX_THREADS);
+
+    for (unsigned int i = 1; i < threads; i++)
+        _threads.emplace_back(_work);
+
+    // Threads still running when they're destroyed would abort the game.
+    atexit(_stop);
+}
+
+void run(int count, void (*job)(int index))
+{
+    if (_threads.empty() || count <= 1)
+    {
+        for (int i = 0; i < count; i++)
+            job(i);
+
+        return;
+    }
+
+    {
+        unique_lock<mutex> lock(_mutex);
+
+        // Workers late to the last run may still be in it, with nothing left
+        // to take from it, but would take from this one.
+        _finished.wait(lock, [] { return _busyWorkers == 0; });
+
+        _job = job;
+        _count = count;
+        _next = 0;
+        _run++;
+    }
+
+    _started.notify_all();
+
+    _take(job, count);
+
+    // Once all the indices are taken, the jobs left are those of the workers
+    // still in the run.
+    unique_lock<mutex> lock(_mutex);
+
+    _finished.wait(lock, [] { return _busyWorkers == 0; });
+}
+
+void _work()
+{
+    unsigned long long lastRun = 0;
+
+    while (true)
+    {
+        void (*job)(int);
+        int count;
+
+        {
+            unique_lock<mutex> lock(_mutex);
+
+            _started.wait(lock, [&] { return _stopping || _run != lastRun; });
+
+            if (_stopping) return;
+
+            lastRun = _run;
+            job = _job;
+            count = _count;
+            _busyWorkers++;
+        }
+
+        _take(job, count);
+
+        {
+            lock_guard<mutex> lock(_mutex);
+
+            _busyWorkers--;
+
+            if (_busyWorkers == 0) _finished.notify_one();
+        }
+    }
+}
+
+void _take(void (*job)(int), int count)
+{
+    for (int i = _next++; i < count; i = _next++)
+        job(i);
+}
+
+void _stop()
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        _stopping = true;
+    }
+
+    _started.notify_all();
+
+    for (thread& t : _threads)
+        t.join();
+
+    _threads.clear();
+}
+
+} // namespace smocc::workers
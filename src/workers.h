@@ -0,0 +1,28 @@
+/*
+
+workers.h: Worker thread pool for SMOCC
+
+Copyright (C) 2024 Nicola Fiori (JD342)
+
+This file is part of SMOCC, licensed under GNU General Public License 3.0.
+
+*/
+
+#pragma once
+
+namespace smocc::workers
+{
+
+// Maximum number of threads jobs are run on, counting the one running them.
+const unsigned int MAX_THREADS = 8;
+
+// Starts a worker for each core past the first, up to the maximum. Workers
+// wait for jobs for as long as the game runs, and are stopped on exit.
+void init();
+
+// Runs `job` for each index from 0 to `count`, excluded, on the workers and on
+// the calling thread, and returns when all of them are done. Jobs with
+// different indices must not write to the same data.
+void run(int count, void (*job)(int index));
+
+} // namespace smocc::workers